@@ -0,0 +1,118 @@
+
+#include "Camera.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+void Camera::Setup(float halfWidth, float halfHeight) {
+	this->halfWidth = halfWidth;
+	this->halfHeight = halfHeight;
+	uploaded = false;
+}
+
+void Camera::Attach(ShaderProgram *program) {
+	programs.push_back(program);
+	uploaded = false;
+}
+
+void Camera::Follow(float x, float y) {
+	targetX = x;
+	targetY = y;
+}
+
+void Camera::SnapToTarget() {
+	x = targetX;
+	y = targetY;
+	Clamp();
+}
+
+void Camera::SetBounds(float left, float right, float bottom, float top) {
+	bounded = true;
+	boundsLeft = left;
+	boundsRight = right;
+	boundsBottom = bottom;
+	boundsTop = top;
+	Clamp();
+}
+
+void Camera::SetZoom(float zoom) {
+	this->zoom = std::min(std::max(zoom, CAMERA_MIN_ZOOM), CAMERA_MAX_ZOOM);
+	Clamp();
+}
+
+void Camera::Shake(float magnitude, float duration) {
+	// A weaker shake never cuts a stronger one short
+	if (shakeTime < shakeDuration && magnitude < shakeMagnitude * (1.0f - shakeTime / shakeDuration)) {
+		return;
+	}
+	shakeMagnitude = magnitude;
+	shakeDuration = duration;
+	shakeTime = 0.0f;
+}
+
+// Keeps the visible rectangle inside the bounds, or centred on them when the
+// bounds are smaller than the view.
+void Camera::Clamp() {
+	if (!bounded) {
+		return;
+	}
+	float viewWidth = halfWidth / zoom;
+	float viewHeight = halfHeight / zoom;
+	if (boundsRight - boundsLeft <= viewWidth * 2.0f) {
+		x = (boundsLeft + boundsRight) * 0.5f;
+	} else {
+		x = std::min(std::max(x, boundsLeft + viewWidth), boundsRight - viewWidth);
+	}
+	if (boundsTop - boundsBottom <= viewHeight * 2.0f) {
+		y = (boundsBottom + boundsTop) * 0.5f;
+	} else {
+		y = std::min(std::max(y, boundsBottom + viewHeight), boundsTop - viewHeight);
+	}
+}
+
+void Camera::Update(float elapsed) {
+	float blend = 1.0f - expf(-followRate * elapsed);
+	x += (targetX - x) * blend;
+	y += (targetY - y) * blend;
+	Clamp();
+
+	shakeX = 0.0f;
+	shakeY = 0.0f;
+	if (shakeTime < shakeDuration) {
+		float amount = shakeMagnitude * (1.0f - shakeTime / shakeDuration);
+		shakeX = ((float) rand() / RAND_MAX * 2.0f - 1.0f) * amount;
+		shakeY = ((float) rand() / RAND_MAX * 2.0f - 1.0f) * amount;
+		shakeTime += elapsed;
+	} else {
+		shakeMagnitude = 0.0f;
+	}
+}
+
+void Camera::Apply() {
+	float viewX = x + shakeX;
+	float viewY = y + shakeY;
+	if (uploaded && viewX == uploadedX && viewY == uploadedY && zoom == uploadedZoom) {
+		return;
+	}
+	glm::mat4 projectionMatrix = glm::ortho(-halfWidth / zoom, halfWidth / zoom, -halfHeight / zoom, halfHeight / zoom, -1.0f, 1.0f);
+	glm::mat4 viewMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(-viewX, -viewY, 0.0f));
+	for (size_t i = 0; i < programs.size(); i++) {
+		programs[i]->SetProjectionMatrix(projectionMatrix);
+		programs[i]->SetViewMatrix(viewMatrix);
+	}
+	uploaded = true;
+	uploadedX = viewX;
+	uploadedY = viewY;
+	uploadedZoom = zoom;
+	uploads++;
+}
+
+CameraRect Camera::Visible() const {
+	CameraRect rect;
+	rect.left = x + shakeX - halfWidth / zoom;
+	rect.right = x + shakeX + halfWidth / zoom;
+	rect.bottom = y + shakeY - halfHeight / zoom;
+	rect.top = y + shakeY + halfHeight / zoom;
+	return rect;
+}
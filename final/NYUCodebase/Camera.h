@@ -0,0 +1,67 @@
+#pragma once
+
+#include "ShaderProgram.h"
+#include <vector>
+
+#define CAMERA_FOLLOW_RATE 8.0f
+#define CAMERA_MIN_ZOOM 0.25f
+#define CAMERA_MAX_ZOOM 4.0f
+
+// World space rectangle the camera sees.
+struct CameraRect {
+	float left;
+	float right;
+	float bottom;
+	float top;
+
+	bool Overlaps(float x, float y, float halfWidth, float halfHeight) const {
+		return x + halfWidth > left && x - halfWidth < right && y + halfHeight > bottom && y - halfHeight < top;
+	}
+};
+
+// 2D camera that eases towards a target, stays inside the level bounds and can
+// zoom and shake. Apply() only uploads the projection and view matrices to the
+// attached programs when the view actually moved, zoomed or shook since the
+// last upload.
+class Camera {
+public:
+	void Setup(float halfWidth, float halfHeight);
+	void Attach(ShaderProgram *program);
+
+	void Follow(float x, float y);
+	void SnapToTarget();
+	void SetBounds(float left, float right, float bottom, float top);
+	void SetZoom(float zoom);
+	void Shake(float magnitude, float duration);
+	void Update(float elapsed);
+
+	void Apply();
+	CameraRect Visible() const;
+
+	float x = 0.0f;
+	float y = 0.0f;
+	float zoom = 1.0f;
+	float followRate = CAMERA_FOLLOW_RATE;
+	unsigned int uploads = 0;
+
+private:
+	void Clamp();
+
+	float halfWidth = 1.0f;
+	float halfHeight = 1.0f;
+	float targetX = 0.0f;
+	float targetY = 0.0f;
+
+	bool bounded = false;
+	float boundsLeft, boundsRight, boundsBottom, boundsTop;
+
+	float shakeMagnitude = 0.0f;
+	float shakeDuration = 0.0f;
+	float shakeTime = 0.0f;
+	float shakeX = 0.0f;
+	float shakeY = 0.0f;
+
+	bool uploaded = false;
+	float uploadedX, uploadedY, uploadedZoom;
+	std::vector<ShaderProgram *> programs;
+};
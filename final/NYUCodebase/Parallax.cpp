@@ -0,0 +1,72 @@
+
+#include "Parallax.h"
+#include <algorithm>
+#include <cmath>
+
+void ParallaxBackground::Setup(const char *vertexShaderFile, const char *fragmentShaderFile) {
+	program.Load(vertexShaderFile, fragmentShaderFile);
+	cameraPositionUniform = glGetUniformLocation(program.programID, "cameraPosition");
+	viewHalfSizeUniform = glGetUniformLocation(program.programID, "viewHalfSize");
+	scrollUniform = glGetUniformLocation(program.programID, "scroll");
+	factorUniform = glGetUniformLocation(program.programID, "factor");
+	repeatSizeUniform = glGetUniformLocation(program.programID, "repeatSize");
+	opacityUniform = glGetUniformLocation(program.programID, "opacity");
+}
+
+void ParallaxBackground::Cleanup() {
+	program.Cleanup();
+	layers.clear();
+}
+
+static bool FartherLayer(const ParallaxLayer &a, const ParallaxLayer &b) {
+	return a.factor < b.factor;
+}
+
+// Layers are kept sorted far to near, the order they have to be drawn in.
+void ParallaxBackground::AddLayer(GLuint texture, float factor, float repeatSize, float opacity, float scrollSpeedX, float scrollSpeedY) {
+	ParallaxLayer layer;
+	layer.texture = texture;
+	layer.factor = factor;
+	layer.repeatSize = repeatSize;
+	layer.opacity = opacity;
+	layer.scrollSpeedX = scrollSpeedX;
+	layer.scrollSpeedY = scrollSpeedY;
+	layer.scrollX = 0.0f;
+	layer.scrollY = 0.0f;
+	layers.push_back(layer);
+	std::stable_sort(layers.begin(), layers.end(), FartherLayer);
+}
+
+// Scroll wraps at the repeat size, so it stays small enough for float precision however long it runs.
+void ParallaxBackground::Update(float elapsed) {
+	for (size_t i = 0; i < layers.size(); i++) {
+		ParallaxLayer &layer = layers[i];
+		layer.scrollX = fmodf(layer.scrollX + layer.scrollSpeedX * elapsed, layer.repeatSize);
+		layer.scrollY = fmodf(layer.scrollY + layer.scrollSpeedY * elapsed, layer.repeatSize);
+	}
+}
+
+void ParallaxBackground::Render(const CameraRect &view) {
+	if (layers.empty()) {
+		return;
+	}
+	float vertices[] = { -1.0f, -1.0f, 1.0f, -1.0f, 1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, -1.0f, 1.0f };
+
+	glUseProgram(program.programID);
+	glUniform2f(cameraPositionUniform, (view.left + view.right) * 0.5f, (view.bottom + view.top) * 0.5f);
+	glUniform2f(viewHalfSizeUniform, (view.right - view.left) * 0.5f, (view.top - view.bottom) * 0.5f);
+	glVertexAttribPointer(program.positionAttribute, 2, GL_FLOAT, false, 0, vertices);
+	glEnableVertexAttribArray(program.positionAttribute);
+
+	for (size_t i = 0; i < layers.size(); i++) {
+		const ParallaxLayer &layer = layers[i];
+		glBindTexture(GL_TEXTURE_2D, layer.texture);
+		glUniform2f(scrollUniform, layer.scrollX, layer.scrollY);
+		glUniform1f(factorUniform, layer.factor);
+		glUniform1f(repeatSizeUniform, layer.repeatSize);
+		glUniform1f(opacityUniform, layer.opacity);
+		glDrawArrays(GL_TRIANGLES, 0, 6);
+	}
+
+	glDisableVertexAttribArray(program.positionAttribute);
+}
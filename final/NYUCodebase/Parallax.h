@@ -0,0 +1,44 @@
+#pragma once
+
+#include "ShaderProgram.h"
+#include "Camera.h"
+#include <vector>
+
+// One repeating background texture. factor is how far it moves for each unit
+// the camera moves (0 stays put, 1 moves with the world), repeatSize is the
+// world size of one copy of the texture and scroll drifts it over time.
+struct ParallaxLayer {
+	GLuint texture;
+	float factor;
+	float repeatSize;
+	float opacity;
+	float scrollSpeedX;
+	float scrollSpeedY;
+	float scrollX;
+	float scrollY;
+};
+
+// Draws repeating background layers behind everything else. Each layer is a
+// single screen covering quad whose texture coordinates are worked out in the
+// vertex shader from the camera position, so the cost is one draw per layer
+// however large the world is.
+class ParallaxBackground {
+public:
+	void Setup(const char *vertexShaderFile, const char *fragmentShaderFile);
+	void Cleanup();
+
+	void AddLayer(GLuint texture, float factor, float repeatSize, float opacity, float scrollSpeedX = 0.0f, float scrollSpeedY = 0.0f);
+	void Update(float elapsed);
+	void Render(const CameraRect &view);
+
+	ShaderProgram program;
+	std::vector<ParallaxLayer> layers;
+
+private:
+	GLint cameraPositionUniform;
+	GLint viewHalfSizeUniform;
+	GLint scrollUniform;
+	GLint factorUniform;
+	GLint repeatSizeUniform;
+	GLint opacityUniform;
+};
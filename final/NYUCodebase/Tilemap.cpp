@@ -0,0 +1,288 @@
+
+#include "Tilemap.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+void Tilemap::Setup(int width, int height, int layers, float tileSize, GLuint texture, int tilesetColumns, int tilesetRows) {
+	Cleanup();
+	this->width = width;
+	this->height = height;
+	this->layers = layers;
+	this->tileSize = tileSize;
+	this->texture = texture;
+	this->tilesetColumns = tilesetColumns;
+	this->tilesetRows = tilesetRows;
+	chunksX = (width + TILE_CHUNK_SIZE - 1) / TILE_CHUNK_SIZE;
+	chunksY = (height + TILE_CHUNK_SIZE - 1) / TILE_CHUNK_SIZE;
+
+	TileChunk empty;
+	for (int i = 0; i < TILE_CHUNK_SIZE * TILE_CHUNK_SIZE; i++) {
+		empty.tiles[i] = TILE_EMPTY;
+	}
+	chunks.assign(layers * chunksX * chunksY, empty);
+	shapes.assign(tilesetColumns * tilesetRows, TILE_NONE);
+}
+
+void Tilemap::Cleanup() {
+	for (size_t i = 0; i < chunks.size(); i++) {
+		if (chunks[i].vertexBuffer != 0) {
+			glDeleteBuffers(1, &chunks[i].vertexBuffer);
+		}
+	}
+	chunks.clear();
+}
+
+TileChunk &Tilemap::Chunk(int layer, int chunkX, int chunkY) {
+	return chunks[(layer * chunksY + chunkY) * chunksX + chunkX];
+}
+
+void Tilemap::SetTile(int layer, int x, int y, int tile) {
+	if (layer < 0 || layer >= layers || x < 0 || x >= width || y < 0 || y >= height) {
+		return;
+	}
+	// Anything stored has to be a tile of the tileset, GetShape indexes shapes with it
+	if (tile != TILE_EMPTY && (tile < 0 || tile >= (int) shapes.size())) {
+		std::cout << "Tile " << tile << " is not in the tileset" << std::endl;
+		return;
+	}
+	TileChunk &chunk = Chunk(layer, x / TILE_CHUNK_SIZE, y / TILE_CHUNK_SIZE);
+	short &slot = chunk.tiles[(y % TILE_CHUNK_SIZE) * TILE_CHUNK_SIZE + x % TILE_CHUNK_SIZE];
+	if (slot != tile) {
+		slot = (short) tile;
+		chunk.dirty = true;
+	}
+}
+
+int Tilemap::GetTile(int layer, int x, int y) const {
+	if (layer < 0 || layer >= layers || x < 0 || x >= width || y < 0 || y >= height) {
+		return TILE_EMPTY;
+	}
+	const TileChunk &chunk = chunks[(layer * chunksY + y / TILE_CHUNK_SIZE) * chunksX + x / TILE_CHUNK_SIZE];
+	return chunk.tiles[(y % TILE_CHUNK_SIZE) * TILE_CHUNK_SIZE + x % TILE_CHUNK_SIZE];
+}
+
+void Tilemap::SetTileShape(int tile, TileShape shape) {
+	if (tile >= 0 && tile < (int) shapes.size()) {
+		shapes[tile] = (unsigned char) shape;
+	}
+}
+
+TileShape Tilemap::GetShape(int layer, int x, int y) const {
+	int tile = GetTile(layer, x, y);
+	if (tile == TILE_EMPTY) {
+		return TILE_NONE;
+	}
+	return (TileShape) shapes[tile];
+}
+
+TileContacts Tilemap::Move(int layer, float &x, float &y, float halfWidth, float halfHeight, float dx, float dy, bool grounded) const {
+	TileContacts contacts;
+	MoveX(layer, x, y, halfWidth, halfHeight, dx, grounded, contacts);
+	MoveY(layer, x, y, halfWidth, halfHeight, dy, contacts);
+	SettleOnSlopes(layer, x, y, halfWidth, halfHeight, dy, grounded, contacts);
+	return contacts;
+}
+
+// Walks the columns the leading edge crosses, nearest first. A solid tile no
+// taller than this step above the feet of a grounded box is stepped onto
+// instead, which is what carries a box from the top of a slope onto flat ground.
+void Tilemap::MoveX(int layer, float &x, float &y, float halfWidth, float halfHeight, float dx, bool grounded, TileContacts &contacts) const {
+	if (dx == 0.0f) {
+		return;
+	}
+	float bottom = y - halfHeight;
+	int firstRow = Row(y + halfHeight - TILE_EPSILON);
+	int lastRow = Row(bottom + TILE_EPSILON);
+	float stepHeight = grounded ? fabsf(dx) + TILE_EPSILON : 0.0f;
+	int direction = dx > 0.0f ? 1 : -1;
+	int column = dx > 0.0f ? Column(x + halfWidth - TILE_EPSILON) : Column(x - halfWidth + TILE_EPSILON);
+	int lastColumn = dx > 0.0f ? Column(x + halfWidth + dx - TILE_EPSILON) : Column(x - halfWidth + dx + TILE_EPSILON);
+
+	float lift = 0.0f;
+	while (column != lastColumn) {
+		column += direction;
+		for (int row = firstRow; row <= lastRow; row++) {
+			if (GetShape(layer, column, row) != TILE_SOLID) {
+				continue;
+			}
+			float step = -row * tileSize - bottom;
+			if (step <= stepHeight) {
+				lift = std::max(lift, step);
+				continue;
+			}
+			if (direction > 0) {
+				x = column * tileSize - halfWidth;
+				contacts.right = true;
+			} else {
+				x = (column + 1) * tileSize + halfWidth;
+				contacts.left = true;
+			}
+			y += lift;
+			return;
+		}
+	}
+	x += dx;
+	y += lift;
+}
+
+// Falling stops on solid and one way tiles, rising only on solid ones. Slopes
+// are left to SettleOnSlopes.
+void Tilemap::MoveY(int layer, float x, float &y, float halfWidth, float halfHeight, float dy, TileContacts &contacts) const {
+	if (dy == 0.0f) {
+		return;
+	}
+	int firstColumn = Column(x - halfWidth + TILE_EPSILON);
+	int lastColumn = Column(x + halfWidth - TILE_EPSILON);
+	int direction = dy < 0.0f ? 1 : -1;
+	int row = dy < 0.0f ? Row(y - halfHeight + TILE_EPSILON) : Row(y + halfHeight - TILE_EPSILON);
+	int lastRow = dy < 0.0f ? Row(y - halfHeight + dy + TILE_EPSILON) : Row(y + halfHeight + dy - TILE_EPSILON);
+
+	while (row != lastRow) {
+		row += direction;
+		for (int column = firstColumn; column <= lastColumn; column++) {
+			TileShape shape = GetShape(layer, column, row);
+			if (shape == TILE_SOLID || (shape == TILE_ONE_WAY && direction > 0)) {
+				if (direction > 0) {
+					y = -row * tileSize + halfHeight;
+					contacts.bottom = true;
+				} else {
+					y = -(row + 1) * tileSize - halfHeight;
+					contacts.top = true;
+				}
+				return;
+			}
+		}
+	}
+	y += dy;
+}
+
+// Puts the box's feet on the highest slope point under it. A grounded box is
+// also pulled down onto a slope that drops away beneath it, so walking
+// downhill does not turn into a series of small falls.
+void Tilemap::SettleOnSlopes(int layer, float x, float &y, float halfWidth, float halfHeight, float dy, bool grounded, TileContacts &contacts) const {
+	if (dy > 0.0f) {
+		return;
+	}
+	float left = x - halfWidth;
+	float right = x + halfWidth;
+	float bottom = y - halfHeight;
+	int firstColumn = Column(left + TILE_EPSILON);
+	int lastColumn = Column(right - TILE_EPSILON);
+	int firstRow = Row(y + halfHeight - TILE_EPSILON);
+	int lastRow = Row(bottom + TILE_EPSILON) + 1;
+
+	bool found = false;
+	float floor = 0.0f;
+	for (int row = firstRow; row <= lastRow; row++) {
+		for (int column = firstColumn; column <= lastColumn; column++) {
+			TileShape shape = GetShape(layer, column, row);
+			if (shape != TILE_SLOPE_UP && shape != TILE_SLOPE_DOWN) {
+				continue;
+			}
+			float tileLeft = column * tileSize;
+			float height = shape == TILE_SLOPE_UP ? std::min(right, tileLeft + tileSize) - tileLeft : tileSize - (std::max(left, tileLeft) - tileLeft);
+			float surface = -(row + 1) * tileSize + height;
+			if (!found || surface > floor) {
+				floor = surface;
+				found = true;
+			}
+		}
+	}
+	if (!found) {
+		return;
+	}
+	float reach = grounded ? TILE_STICK_DISTANCE * tileSize : 0.0f;
+	if (bottom < floor + reach && bottom > floor - tileSize) {
+		y = floor + halfHeight;
+		contacts.bottom = true;
+	}
+}
+
+// Six interleaved position and texture coordinate vertices per tile, in world units.
+void Tilemap::BuildChunk(TileChunk &chunk, int chunkX, int chunkY) {
+	std::vector<float> vertexData;
+	vertexData.reserve(TILE_CHUNK_SIZE * TILE_CHUNK_SIZE * 24);
+	float tileWidth = 1.0f / (float) tilesetColumns;
+	float tileHeight = 1.0f / (float) tilesetRows;
+
+	for (int row = 0; row < TILE_CHUNK_SIZE; row++) {
+		for (int column = 0; column < TILE_CHUNK_SIZE; column++) {
+			int tile = chunk.tiles[row * TILE_CHUNK_SIZE + column];
+			if (tile == TILE_EMPTY) {
+				continue;
+			}
+			float u = (float) (tile % tilesetColumns) * tileWidth;
+			float v = (float) (tile / tilesetColumns) * tileHeight;
+			float x = (float) (chunkX * TILE_CHUNK_SIZE + column) * tileSize;
+			float y = -(float) (chunkY * TILE_CHUNK_SIZE + row) * tileSize;
+
+			vertexData.insert(vertexData.end(), {
+				x, y, u, v,
+				x, y - tileSize, u, v + tileHeight,
+				x + tileSize, y - tileSize, u + tileWidth, v + tileHeight,
+				x, y, u, v,
+				x + tileSize, y - tileSize, u + tileWidth, v + tileHeight,
+				x + tileSize, y, u + tileWidth, v
+			});
+		}
+	}
+
+	chunk.vertexCount = (int) vertexData.size() / 4;
+	chunk.dirty = false;
+	chunkBuilds++;
+	if (chunk.vertexCount == 0) {
+		return;
+	}
+	if (chunk.vertexBuffer == 0) {
+		glGenBuffers(1, &chunk.vertexBuffer);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, chunk.vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertexData.size() * sizeof(float), vertexData.data(), GL_STATIC_DRAW);
+}
+
+void Tilemap::Render(ShaderProgram &program, float left, float right, float bottom, float top) {
+	drawCalls = 0;
+	if (chunks.empty()) {
+		return;
+	}
+
+	// Chunks whose tiles overlap the view, with row indices growing downwards
+	float chunkSize = TILE_CHUNK_SIZE * tileSize;
+	int firstX = std::max(0, (int) floorf(left / chunkSize));
+	int lastX = std::min(chunksX - 1, (int) floorf(right / chunkSize));
+	int firstY = std::max(0, (int) floorf(-top / chunkSize));
+	int lastY = std::min(chunksY - 1, (int) floorf(-bottom / chunkSize));
+	if (firstX > lastX || firstY > lastY) {
+		return;
+	}
+
+	glUseProgram(program.programID);
+	program.SetModelMatrix(glm::mat4(1.0f));
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glEnableVertexAttribArray(program.positionAttribute);
+	glEnableVertexAttribArray(program.texCoordAttribute);
+
+	for (int layer = 0; layer < layers; layer++) {
+		for (int chunkY = firstY; chunkY <= lastY; chunkY++) {
+			for (int chunkX = firstX; chunkX <= lastX; chunkX++) {
+				TileChunk &chunk = Chunk(layer, chunkX, chunkY);
+				if (chunk.dirty) {
+					BuildChunk(chunk, chunkX, chunkY);
+				}
+				if (chunk.vertexCount == 0) {
+					continue;
+				}
+				glBindBuffer(GL_ARRAY_BUFFER, chunk.vertexBuffer);
+				glVertexAttribPointer(program.positionAttribute, 2, GL_FLOAT, false, 4 * sizeof(float), (void *) 0);
+				glVertexAttribPointer(program.texCoordAttribute, 2, GL_FLOAT, false, 4 * sizeof(float), (void *) (2 * sizeof(float)));
+				glDrawArrays(GL_TRIANGLES, 0, chunk.vertexCount);
+				drawCalls++;
+			}
+		}
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glDisableVertexAttribArray(program.positionAttribute);
+	glDisableVertexAttribArray(program.texCoordAttribute);
+}
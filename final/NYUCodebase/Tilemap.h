@@ -0,0 +1,78 @@
+#pragma once
+
+#include "ShaderProgram.h"
+#include <cmath>
+#include <vector>
+
+#define TILE_CHUNK_SIZE 32
+#define TILE_EMPTY -1
+#define TILE_EPSILON 0.0001f
+#define TILE_STICK_DISTANCE 0.5f
+
+// How a tileset index collides. Slopes fill the tile below a diagonal that
+// rises to the right (up) or falls to the right (down); one way tiles only
+// stop things moving down onto them.
+enum TileShape { TILE_NONE, TILE_SOLID, TILE_ONE_WAY, TILE_SLOPE_UP, TILE_SLOPE_DOWN };
+
+struct TileContacts {
+	bool left = false;
+	bool right = false;
+	bool top = false;
+	bool bottom = false;
+};
+
+// One TILE_CHUNK_SIZE square of a layer. Its quads live in a static vertex
+// buffer that is only rebuilt after one of its tiles changes.
+struct TileChunk {
+	short tiles[TILE_CHUNK_SIZE * TILE_CHUNK_SIZE];
+	GLuint vertexBuffer = 0;
+	int vertexCount = 0;
+	bool dirty = true;
+};
+
+// Tile layers drawn from a tileset texture laid out as a uniform grid. Tile
+// (0, 0) is the top left corner of the map and sits at the world origin, with
+// rows going down the screen. Each layer is drawn back to front, one draw call
+// per chunk that is on screen and has any tiles in it.
+//
+// Move() resolves a box against one layer, x first and then y, only looking at
+// the tiles between where the box starts and where it would end up.
+class Tilemap {
+public:
+	void Setup(int width, int height, int layers, float tileSize, GLuint texture, int tilesetColumns, int tilesetRows);
+	void Cleanup();
+
+	void SetTile(int layer, int x, int y, int tile);
+	int GetTile(int layer, int x, int y) const;
+
+	void SetTileShape(int tile, TileShape shape);
+	TileShape GetShape(int layer, int x, int y) const;
+	TileContacts Move(int layer, float &x, float &y, float halfWidth, float halfHeight, float dx, float dy, bool grounded) const;
+
+	void Render(ShaderProgram &program, float left, float right, float bottom, float top);
+
+	int width = 0;
+	int height = 0;
+	int layers = 0;
+	float tileSize = 1.0f;
+
+	unsigned int drawCalls = 0;
+	unsigned int chunkBuilds = 0;
+
+private:
+	TileChunk &Chunk(int layer, int chunkX, int chunkY);
+	void BuildChunk(TileChunk &chunk, int chunkX, int chunkY);
+	int Column(float x) const { return (int) floorf(x / tileSize); }
+	int Row(float y) const { return (int) floorf(-y / tileSize); }
+	void MoveX(int layer, float &x, float &y, float halfWidth, float halfHeight, float dx, bool grounded, TileContacts &contacts) const;
+	void MoveY(int layer, float x, float &y, float halfWidth, float halfHeight, float dy, TileContacts &contacts) const;
+	void SettleOnSlopes(int layer, float x, float &y, float halfWidth, float halfHeight, float dy, bool grounded, TileContacts &contacts) const;
+
+	GLuint texture = 0;
+	int tilesetColumns = 1;
+	int tilesetRows = 1;
+	int chunksX = 0;
+	int chunksY = 0;
+	std::vector<TileChunk> chunks;
+	std::vector<unsigned char> shapes;
+};
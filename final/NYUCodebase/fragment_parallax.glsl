@@ -0,0 +1,9 @@
+uniform sampler2D texture0;
+uniform float opacity;
+
+varying vec2 texCoordVar;
+
+void main() {
+	vec4 color = texture2D(texture0, texCoordVar);
+	gl_FragColor = vec4(color.rgb, color.a * opacity);
+}
\ No newline at end of file
@@ -5,7 +5,9 @@
 #define GL_GLEXT_PROTOTYPES 1
 #include <SDL_opengl.h>
 #include <SDL_image.h>
+#include <algorithm>
 #include <chrono>
+#include <cstring>
 #include <thread>
 #include <vector>
 
@@ -18,20 +20,36 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #include "ShaderProgram.h"
+#include "Tilemap.h"
+#include "Camera.h"
+#include "Parallax.h"
 #include "glm/mat4x4.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 
+#define TILE_SIZE 0.125f
+#define LAYER_BACKGROUND 0
+#define LAYER_SOLID 1
+#define FIXED_TIMESTEP (1.0f / 60.0f)
+#define MAX_TIMESTEPS 6
+#define GRAVITY -6.0f
+#define WALK_SPEED 1.2f
+#define JUMP_SPEED 2.8f
+#define HARD_LANDING_SPEED 3.5f
+#define ZOOM_SPEED 1.0f
+
 SDL_Window* displayWindow;
 SDL_GLContext context;
 ShaderProgram program;
 ShaderProgram texturedProgram;
 const Uint8 *keys;
-glm::mat4 projectionMatrix, viewMatrix;
+Camera camera;
+ParallaxBackground background;
 
 enum GameMode { MAIN_MENU, GAME_LEVEL, GAME_OVER };
 bool done = false;
 float lastFrameTicks = 0.0f;
 float timer = 0.0f;
+float accumulator = 0.0f;
 
 GLuint LoadTexture(const char *filePath) {
 	int w, h, comp;
@@ -54,6 +72,13 @@ GLuint LoadTexture(const char *filePath) {
 	return retTexture;
 }
 
+GLuint LoadRepeatingTexture(const char *filePath) {
+	GLuint texture = LoadTexture(filePath);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	return texture;
+}
+
 class SheetSprite {
 public:
 	SheetSprite() {};
@@ -156,7 +181,12 @@ struct MainMenuState {
 };
 
 struct GameState {
+	Tilemap map;
+	Entity player;
+	bool grounded = false;
+
 	void Setup();
+	void Spawn();
 	void ProcessEvents();
 	void Update(float elapsed);
 	void Render();
@@ -214,8 +244,61 @@ void MainMenuState::Setup() {
 
 }
 
+// Placeholder level drawn with font.png as the tileset, so each character is its own tile.
+// '.' and the '~' water in the pits go on the background layer and everything else
+// on the solid layer, where '=' is a one way platform and '/' and '\' are slopes.
+const char *LEVEL_ROWS[] = {
+	"                                                                                                ",
+	"   .            .                 .              .           .             .              .     ",
+	"                                                                                                ",
+	"         .              .                .             .            .             .             ",
+	"                                                                                                ",
+	"                           ====                                          ====                   ",
+	"  .                                   .          ======      .                          .       ",
+	"               ====                                                             =====           ",
+	"                            .                ====                   ====                        ",
+	"        ====                       =====                                                 ====   ",
+	"                                                           ===                                  ",
+	"                     ====     /####\\                  ====                  /###\\               ",
+	"#########     ##########   ###############    ###############    ##########################     ",
+	"#########     ##########   ###############    ###############    ##########################   ##",
+	"#########~~~~~##########~~~###############~~~~###############~~~~##########################~~~##",
+};
+
 void GameState::Setup() {
+	int height = sizeof(LEVEL_ROWS) / sizeof(LEVEL_ROWS[0]);
+	int width = 0;
+	for (int y = 0; y < height; y++) {
+		width = std::max(width, (int) strlen(LEVEL_ROWS[y]));
+	}
+	map.Setup(width, height, 2, TILE_SIZE, fontSheet, 16, 16);
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; LEVEL_ROWS[y][x] != '\0'; x++) {
+			char tile = LEVEL_ROWS[y][x];
+			if (tile == '.' || tile == '~') {
+				map.SetTile(LAYER_BACKGROUND, x, y, tile);
+			} else if (tile != ' ') {
+				map.SetTile(LAYER_SOLID, x, y, tile);
+			}
+		}
+	}
+	map.SetTileShape('#', TILE_SOLID);
+	map.SetTileShape('=', TILE_ONE_WAY);
+	map.SetTileShape('/', TILE_SLOPE_UP);
+	map.SetTileShape('\\', TILE_SLOPE_DOWN);
+	camera.SetBounds(0.0f, width * TILE_SIZE, -height * TILE_SIZE, 0.0f);
+
+	float glyph = 1.0f / 16.0f;
+	player.sprite = SheetSprite(fontSheet, ('@' % 16) * glyph, ('@' / 16) * glyph, glyph, glyph, TILE_SIZE * 0.9f);
+	Spawn();
+}
 
+void GameState::Spawn() {
+	player.position = glm::vec3(1.0f, -1.0f, 0.0f);
+	player.velocity = glm::vec3(0.0f, 0.0f, 0.0f);
+	grounded = false;
+	camera.Follow(player.position.x, player.position.y);
+	camera.SnapToTarget();
 }
 
 void Setup() {
@@ -229,6 +312,8 @@ void Setup() {
 #endif
 
 	glViewport(0, 0, 640, 640);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	program.Load("vertex.glsl", "fragment.glsl");
 	texturedProgram.Load("vertex_textured.glsl", "fragment_textured.glsl");
 
@@ -236,15 +321,15 @@ void Setup() {
 	textureSheet = LoadTexture("assets/SpaceShooter/Spritesheet/sheet.png");
 	mode = MAIN_MENU;
 
-	projectionMatrix = glm::mat4(1.0f);
-	projectionMatrix = glm::ortho(-1.777f, 1.777f, -1.0f, 1.0f, -1.0f, 1.0f);
-	viewMatrix = glm::mat4(1.0f);
-	
-	program.SetProjectionMatrix(projectionMatrix);
-	program.SetViewMatrix(viewMatrix);
+	camera.Setup(1.777f, 1.0f);
+	camera.Attach(&program);
+	camera.Attach(&texturedProgram);
+	camera.Apply();
 
-	texturedProgram.SetProjectionMatrix(projectionMatrix);
-	texturedProgram.SetViewMatrix(viewMatrix);
+	background.Setup("vertex_parallax.glsl", "fragment_parallax.glsl");
+	background.AddLayer(LoadRepeatingTexture("assets/SpaceShooter/Backgrounds/darkPurple.png"), 0.1f, 2.0f, 1.0f);
+	background.AddLayer(LoadRepeatingTexture("assets/SpaceShooter/Backgrounds/purple.png"), 0.3f, 1.5f, 0.3f, 0.05f, 0.0f);
+	background.AddLayer(LoadRepeatingTexture("assets/SpaceShooter/Backgrounds/blue.png"), 0.6f, 1.0f, 0.2f, 0.1f, 0.02f);
 
 	glUseProgram(texturedProgram.programID);
 
@@ -258,6 +343,10 @@ void MainMenuState::ProcessEvents() {
 	while (SDL_PollEvent(&event)) {
 		if (event.type == SDL_QUIT || event.type == SDL_WINDOWEVENT_CLOSE) {
 			done = true;
+		} else if ((event.type == SDL_MOUSEBUTTONDOWN && event.button.button == 1) ||
+			(event.type == SDL_KEYDOWN && event.key.keysym.scancode == SDL_SCANCODE_RETURN)) {
+			mode = GAME_LEVEL;
+			gameState.Setup();
 		}
 	}
 }
@@ -271,9 +360,78 @@ void GameState::ProcessEvents() {
 	}
 }
 
+void GameState::Update(float elapsed) {
+	player.velocity.x = 0.0f;
+	if (keys[SDL_SCANCODE_LEFT]) {
+		player.velocity.x -= WALK_SPEED;
+	}
+	if (keys[SDL_SCANCODE_RIGHT]) {
+		player.velocity.x += WALK_SPEED;
+	}
+	if (grounded && (keys[SDL_SCANCODE_UP] || keys[SDL_SCANCODE_SPACE])) {
+		player.velocity.y = JUMP_SPEED;
+		grounded = false;
+	}
+	if (keys[SDL_SCANCODE_EQUALS]) {
+		camera.SetZoom(camera.zoom * (1.0f + ZOOM_SPEED * elapsed));
+	}
+	if (keys[SDL_SCANCODE_MINUS]) {
+		camera.SetZoom(camera.zoom / (1.0f + ZOOM_SPEED * elapsed));
+	}
+	player.velocity.y += GRAVITY * elapsed;
+	float fallSpeed = -player.velocity.y;
+
+	float halfHeight = player.sprite.size * 0.5f;
+	float halfWidth = halfHeight * player.sprite.width / player.sprite.height;
+	TileContacts contacts = map.Move(LAYER_SOLID, player.position.x, player.position.y, halfWidth, halfHeight,
+		player.velocity.x * elapsed, player.velocity.y * elapsed, grounded);
+	if (contacts.bottom && !grounded && fallSpeed > HARD_LANDING_SPEED) {
+		camera.Shake(0.02f * fallSpeed / HARD_LANDING_SPEED, 0.25f);
+	}
+	grounded = contacts.bottom;
+	if (contacts.bottom || contacts.top) {
+		player.velocity.y = 0.0f;
+	}
+	if (player.position.y < -(map.height + 4) * TILE_SIZE) {
+		Spawn();
+	}
+
+	camera.Follow(player.position.x, player.position.y);
+	camera.Update(elapsed);
+	background.Update(elapsed);
+}
+
+void MainMenuState::Render() {
+	glm::mat4 modelMatrix = glm::mat4(1.0f);
+	modelMatrix = glm::translate(modelMatrix, glm::vec3(-1.2f, 0.3f, 0.0f));
+	texturedProgram.SetModelMatrix(modelMatrix);
+	DrawText(texturedProgram, fontSheet, "Final Project", 0.2f, 0.0f);
+
+	modelMatrix = glm::mat4(1.0f);
+	modelMatrix = glm::translate(modelMatrix, glm::vec3(-0.3f, -0.3f, 0.0f));
+	texturedProgram.SetModelMatrix(modelMatrix);
+	DrawText(texturedProgram, fontSheet, "Start", 0.125f, 0.0f);
+}
+
+void GameState::Render() {
+	camera.Apply();
+	CameraRect view = camera.Visible();
+	background.Render(view);
+	map.Render(texturedProgram, view.left, view.right, view.bottom, view.top);
+	float halfHeight = player.sprite.size * 0.5f;
+	if (view.Overlaps(player.position.x, player.position.y, halfHeight * player.sprite.width / player.sprite.height, halfHeight)) {
+		player.Render(texturedProgram);
+	}
+}
+
 void ProcessEvents() {
 	switch (mode) {
-
+	case MAIN_MENU:
+		mainMenuState.ProcessEvents();
+		break;
+	case GAME_LEVEL:
+		gameState.ProcessEvents();
+		break;
 	}
 }
 
@@ -282,21 +440,41 @@ void Update() {
 	float elapsed = ticks - lastFrameTicks;
 	lastFrameTicks = ticks;
 
-	switch (mode) {
-
+	// Physics always steps by FIXED_TIMESTEP so tile sweeps behave the same at any frame rate
+	elapsed += accumulator;
+	if (elapsed < FIXED_TIMESTEP) {
+		accumulator = elapsed;
+		return;
 	}
+	int steps = 0;
+	while (elapsed >= FIXED_TIMESTEP && steps < MAX_TIMESTEPS) {
+		switch (mode) {
+		case GAME_LEVEL:
+			gameState.Update(FIXED_TIMESTEP);
+			break;
+		}
+		elapsed -= FIXED_TIMESTEP;
+		steps++;
+	}
+	accumulator = steps < MAX_TIMESTEPS ? elapsed : 0.0f;
 }
 
 void Render() {
 	glClear(GL_COLOR_BUFFER_BIT);
 	switch (mode) {
-
+	case MAIN_MENU:
+		mainMenuState.Render();
+		break;
+	case GAME_LEVEL:
+		gameState.Render();
+		break;
 	}
 	SDL_GL_SwapWindow(displayWindow);
 }
 
 void Cleanup() {
-
+	gameState.map.Cleanup();
+	background.Cleanup();
 }
 
 int main(int argc, char *argv[]) {
@@ -0,0 +1,17 @@
+attribute vec4 position;
+
+uniform vec2 cameraPosition;
+uniform vec2 viewHalfSize;
+uniform vec2 scroll;
+uniform float factor;
+uniform float repeatSize;
+
+varying vec2 texCoordVar;
+
+// position is already in clip space; the world point under it gives the texture coordinate
+void main()
+{
+	vec2 world = cameraPosition * factor + position.xy * viewHalfSize + scroll;
+	texCoordVar = vec2(world.x, -world.y) / repeatSize;
+	gl_Position = vec4(position.xy, 0.0, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,259 @@
+
+#include "AudioMixer.h"
+#include <cstring>
+#include <iostream>
+
+bool AudioCommandQueue::Push(const AudioCommand &command) {
+	unsigned int currentTail = tail.load(std::memory_order_relaxed);
+	unsigned int next = (currentTail + 1) % AUDIO_COMMAND_QUEUE_SIZE;
+	if (next == head.load(std::memory_order_acquire)) {
+		return false;
+	}
+	commands[currentTail] = command;
+	tail.store(next, std::memory_order_release);
+	return true;
+}
+
+bool AudioCommandQueue::Pop(AudioCommand &command) {
+	unsigned int currentHead = head.load(std::memory_order_relaxed);
+	if (currentHead == tail.load(std::memory_order_acquire)) {
+		return false;
+	}
+	command = commands[currentHead];
+	head.store((currentHead + 1) % AUDIO_COMMAND_QUEUE_SIZE, std::memory_order_release);
+	return true;
+}
+
+bool AudioMixer::Open(const char *driver, int frequency, int bufferFrames) {
+	if (driver != NULL) {
+		SDL_setenv("SDL_AUDIODRIVER", driver, 1);
+	}
+	if (SDL_InitSubSystem(SDL_INIT_AUDIO) != 0) {
+		std::cout << "Unable to initialize audio: " << SDL_GetError() << std::endl;
+		return false;
+	}
+	if (Mix_OpenAudio(frequency, AUDIO_S16SYS, 2, bufferFrames) != 0) {
+		std::cout << "Unable to open audio device: " << SDL_GetError() << std::endl;
+		SDL_QuitSubSystem(SDL_INIT_AUDIO);
+		return false;
+	}
+
+	Uint16 format;
+	int channels;
+	Mix_QuerySpec(&this->frequency, &format, &channels);
+	if (format != AUDIO_S16SYS || channels != 2) {
+		std::cout << "Unsupported audio format, audio disabled" << std::endl;
+		Mix_CloseAudio();
+		SDL_QuitSubSystem(SDL_INIT_AUDIO);
+		return false;
+	}
+
+	this->bufferFrames = bufferFrames;
+	counterFrequency = SDL_GetPerformanceFrequency();
+	for (int i = 0; i < MAX_VOICES; i++) {
+		voices[i].active = false;
+	}
+	Mix_SetPostMix(&AudioMixer::MixCallback, this);
+	open = true;
+	return true;
+}
+
+void AudioMixer::Close() {
+	if (!open) {
+		return;
+	}
+	Mix_SetPostMix(NULL, NULL);
+	for (size_t i = 0; i < samples.size(); i++) {
+		Mix_FreeChunk(samples[i].chunk);
+	}
+	samples.clear();
+	Mix_CloseAudio();
+	SDL_QuitSubSystem(SDL_INIT_AUDIO);
+	open = false;
+}
+
+int AudioMixer::LoadSample(const char *filePath) {
+	if (!open) {
+		return -1;
+	}
+	for (size_t i = 0; i < samples.size(); i++) {
+		if (samples[i].name == filePath) {
+			return (int) i;
+		}
+	}
+
+	// Mix_LoadWAV decodes and converts to the device format up front, so mixing is a plain add
+	Mix_Chunk *chunk = Mix_LoadWAV(filePath);
+	if (chunk == NULL) {
+		std::cout << "Unable to load sound " << filePath << ": " << SDL_GetError() << std::endl;
+		return -1;
+	}
+
+	Sample sample;
+	sample.name = filePath;
+	sample.chunk = chunk;
+	sample.data = (const Sint16 *) chunk->abuf;
+	sample.frames = (int) (chunk->alen / (2 * sizeof(Sint16)));
+
+	SDL_LockAudio();
+	samples.push_back(sample);
+	SDL_UnlockAudio();
+	return (int) samples.size() - 1;
+}
+
+void AudioMixer::Play(int sample, int priority, float volume) {
+	if (!open || sample < 0) {
+		return;
+	}
+	AudioCommand command;
+	command.type = AudioCommand::PLAY;
+	command.sample = sample;
+	command.priority = priority;
+	command.volume = (int) (volume * MIX_MAX_VOLUME);
+	command.issued = SDL_GetPerformanceCounter();
+	if (!queue.Push(command)) {
+		dropped++;
+	}
+}
+
+void AudioMixer::StopAll() {
+	if (!open) {
+		return;
+	}
+	AudioCommand command;
+	command.type = AudioCommand::STOP_ALL;
+	command.issued = SDL_GetPerformanceCounter();
+	queue.Push(command);
+}
+
+void AudioMixer::MixCallback(void *udata, Uint8 *stream, int length) {
+	AudioMixer *mixer = (AudioMixer *) udata;
+	Sint16 *output = (Sint16 *) stream;
+	int frames = length / (2 * sizeof(Sint16));
+	while (frames > 0) {
+		int block = frames < AUDIO_MAX_BUFFER_FRAMES ? frames : AUDIO_MAX_BUFFER_FRAMES;
+		mixer->Mix(output, block);
+		output += block * 2;
+		frames -= block;
+	}
+}
+
+void AudioMixer::Start(const AudioCommand &command, Uint64 now) {
+	int slot = -1;
+	for (int i = 0; i < MAX_VOICES; i++) {
+		if (!voices[i].active) {
+			slot = i;
+			break;
+		}
+	}
+
+	// No free voice, steal the least important one, preferring the one that started first
+	if (slot < 0) {
+		for (int i = 0; i < MAX_VOICES; i++) {
+			if (slot < 0 || voices[i].priority < voices[slot].priority ||
+				(voices[i].priority == voices[slot].priority && voices[i].started < voices[slot].started)) {
+				slot = i;
+			}
+		}
+		if (voices[slot].priority > command.priority) {
+			dropped++;
+			return;
+		}
+		stolen++;
+	}
+
+	AudioVoice &voice = voices[slot];
+	voice.active = true;
+	voice.sample = command.sample;
+	voice.frame = 0;
+	voice.priority = command.priority;
+	voice.volume = command.volume;
+	voice.started = command.issued;
+	played++;
+
+	Uint64 latency = now - command.issued;
+	latencyTicks += latency;
+	if (latency > maxLatencyTicks) {
+		maxLatencyTicks = latency;
+	}
+}
+
+void AudioMixer::Mix(Sint16 *output, int frames) {
+	Uint64 begin = SDL_GetPerformanceCounter();
+
+	AudioCommand command;
+	while (queue.Pop(command)) {
+		if (command.type == AudioCommand::STOP_ALL) {
+			for (int i = 0; i < MAX_VOICES; i++) {
+				voices[i].active = false;
+			}
+			continue;
+		}
+		if (command.sample >= (int) samples.size()) {
+			continue;
+		}
+		Start(command, begin);
+	}
+
+	memset(accumulator, 0, sizeof(int) * frames * 2);
+	for (int i = 0; i < MAX_VOICES; i++) {
+		AudioVoice &voice = voices[i];
+		if (!voice.active) {
+			continue;
+		}
+		const Sample &sample = samples[voice.sample];
+		int count = sample.frames - voice.frame;
+		if (count > frames) {
+			count = frames;
+		}
+		const Sint16 *source = sample.data + voice.frame * 2;
+		for (int j = 0; j < count * 2; j++) {
+			accumulator[j] += (source[j] * voice.volume) >> 7;
+		}
+		voice.frame += count;
+		if (voice.frame >= sample.frames) {
+			voice.active = false;
+		}
+	}
+
+	// SDL_mixer's own channels are already in the stream, add on top with saturation
+	for (int j = 0; j < frames * 2; j++) {
+		int value = output[j] + accumulator[j];
+		if (value > 32767) {
+			value = 32767;
+		} else if (value < -32768) {
+			value = -32768;
+		}
+		output[j] = (Sint16) value;
+	}
+
+	callbacks++;
+	mixedFrames += frames;
+	mixTicks += SDL_GetPerformanceCounter() - begin;
+}
+
+AudioStats AudioMixer::GetStats() const {
+	AudioStats stats;
+	stats.callbacks = callbacks;
+	stats.mixedFrames = mixedFrames;
+	stats.mixSeconds = (double) mixTicks / counterFrequency;
+	stats.played = played;
+	stats.stolen = stolen;
+	stats.dropped = dropped;
+	stats.averageLatency = played > 0 ? (double) latencyTicks / played / counterFrequency : 0.0;
+	stats.maxLatency = (double) maxLatencyTicks / counterFrequency;
+	stats.bufferLatency = frequency > 0 ? (double) bufferFrames / frequency : 0.0;
+	return stats;
+}
+
+void AudioMixer::PrintStats() const {
+	AudioStats stats = GetStats();
+	std::cout << "audio driver: " << (open ? SDL_GetCurrentAudioDriver() : "none") << std::endl;
+	std::cout << "audio callbacks: " << stats.callbacks << ", frames mixed: " << stats.mixedFrames << std::endl;
+	if (stats.callbacks > 0) {
+		std::cout << "audio mix cost: " << stats.mixSeconds * 1000000.0 / stats.callbacks << " us per callback" << std::endl;
+	}
+	std::cout << "sounds played: " << stats.played << ", stolen: " << stats.stolen << ", dropped: " << stats.dropped << std::endl;
+	std::cout << "trigger to mix latency: avg " << stats.averageLatency * 1000.0 << " ms, max " << stats.maxLatency * 1000.0
+		<< " ms, plus " << stats.bufferLatency * 1000.0 << " ms device buffer" << std::endl;
+}
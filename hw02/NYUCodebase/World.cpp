@@ -0,0 +1,299 @@
+
+#include "World.h"
+#include <cstring>
+#include <iostream>
+
+World::World() {
+	memset(componentSizes, 0, sizeof(componentSizes));
+}
+
+World::~World() {
+	{
+		std::lock_guard<std::mutex> lock(poolMutex);
+		stopping = true;
+	}
+	workReady.notify_all();
+	for (size_t i = 0; i < workers.size(); i++) {
+		workers[i].join();
+	}
+	for (size_t i = 0; i < archetypes.size(); i++) {
+		for (size_t j = 0; j < archetypes[i].chunks.size(); j++) {
+			delete[] archetypes[i].chunks[j].data;
+		}
+	}
+}
+
+static size_t AlignUp(size_t value) {
+	return (value + CHUNK_ALIGNMENT - 1) & ~(size_t) (CHUNK_ALIGNMENT - 1);
+}
+
+int World::FindArchetype(ComponentMask mask) {
+	for (size_t i = 0; i < archetypes.size(); i++) {
+		if (archetypes[i].mask == mask) {
+			return (int) i;
+		}
+	}
+
+	Archetype archetype;
+	archetype.mask = mask;
+	size_t rowBytes = sizeof(EntityID);
+	for (int i = 0; i < MAX_COMPONENTS; i++) {
+		if (mask & (1u << i)) {
+			rowBytes += componentSizes[i];
+		}
+	}
+	// Leave room for the padding between columns
+	archetype.capacity = (int) ((CHUNK_BYTES - CHUNK_ALIGNMENT * (MAX_COMPONENTS + 1)) / rowBytes);
+
+	size_t offset = 0;
+	for (int i = 0; i < MAX_COMPONENTS; i++) {
+		archetype.offsets[i] = 0;
+		if (mask & (1u << i)) {
+			archetype.offsets[i] = offset;
+			offset = AlignUp(offset + componentSizes[i] * archetype.capacity);
+		}
+	}
+	archetype.entityOffset = offset;
+	archetypes.push_back(archetype);
+	// Systems that looked independent may both match the new archetype
+	BuildSchedule();
+	return (int) archetypes.size() - 1;
+}
+
+EntityID World::Create(ComponentMask mask) {
+	int index = FindArchetype(mask);
+	Archetype &archetype = archetypes[index];
+
+	// Chunks before the first one with space are always full, so entities stay packed
+	int chunk = 0;
+	while (chunk < (int) archetype.chunks.size() && archetype.chunks[chunk].count == archetype.capacity) {
+		chunk++;
+	}
+	if (chunk == (int) archetype.chunks.size()) {
+		Chunk newChunk;
+		newChunk.data = new unsigned char[CHUNK_BYTES];
+		newChunk.count = 0;
+		archetype.chunks.push_back(newChunk);
+	}
+
+	Chunk &target = archetype.chunks[chunk];
+	int row = target.count++;
+	for (int i = 0; i < MAX_COMPONENTS; i++) {
+		if (mask & (1u << i)) {
+			memset(target.data + archetype.offsets[i] + componentSizes[i] * row, 0, componentSizes[i]);
+		}
+	}
+
+	EntityID entity;
+	if (!freeEntities.empty()) {
+		entity = freeEntities.back();
+		freeEntities.pop_back();
+	} else {
+		entity = (EntityID) locations.size();
+		locations.push_back(Location());
+	}
+	((EntityID *) (target.data + archetype.entityOffset))[row] = entity;
+	locations[entity].archetype = index;
+	locations[entity].chunk = chunk;
+	locations[entity].row = row;
+	return entity;
+}
+
+void World::Destroy(EntityID entity) {
+	Location location = locations[entity];
+	if (location.archetype < 0) {
+		return;
+	}
+	Archetype &archetype = archetypes[location.archetype];
+
+	int last = (int) archetype.chunks.size() - 1;
+	while (archetype.chunks[last].count == 0) {
+		last--;
+	}
+	Chunk &source = archetype.chunks[last];
+	Chunk &target = archetype.chunks[location.chunk];
+	int sourceRow = source.count - 1;
+
+	// Move the last entity of the archetype into the hole
+	for (int i = 0; i < MAX_COMPONENTS; i++) {
+		if (archetype.mask & (1u << i)) {
+			memcpy(target.data + archetype.offsets[i] + componentSizes[i] * location.row,
+				source.data + archetype.offsets[i] + componentSizes[i] * sourceRow, componentSizes[i]);
+		}
+	}
+	EntityID moved = ((EntityID *) (source.data + archetype.entityOffset))[sourceRow];
+	((EntityID *) (target.data + archetype.entityOffset))[location.row] = moved;
+	locations[moved].chunk = location.chunk;
+	locations[moved].row = location.row;
+	source.count--;
+
+	locations[entity].archetype = -1;
+	freeEntities.push_back(entity);
+}
+
+bool World::Has(EntityID entity, ComponentMask mask) const {
+	const Location &location = locations[entity];
+	return location.archetype >= 0 && (archetypes[location.archetype].mask & mask) == mask;
+}
+
+void World::Query(ComponentMask mask, const std::function<void(ChunkView &)> &callback) {
+	for (size_t i = 0; i < archetypes.size(); i++) {
+		Archetype &archetype = archetypes[i];
+		if ((archetype.mask & mask) != mask) {
+			continue;
+		}
+		for (size_t j = 0; j < archetype.chunks.size(); j++) {
+			if (archetype.chunks[j].count > 0) {
+				ChunkView view(archetype, archetype.chunks[j]);
+				callback(view);
+			}
+		}
+	}
+}
+
+void World::AddSystem(const char *name, ComponentMask reads, ComponentMask writes, const std::function<void(World &, float)> &run, bool mainThread) {
+	SystemAccess access = { 0, reads, writes };
+	AddSystem(name, std::vector<SystemAccess>(1, access), run, mainThread);
+}
+
+void World::AddSystem(const char *name, const std::vector<SystemAccess> &access, const std::function<void(World &, float)> &run, bool mainThread) {
+	System system;
+	system.name = name;
+	system.access = access;
+	system.mainThread = mainThread;
+	system.run = run;
+	systems.push_back(system);
+	BuildSchedule();
+}
+
+// True when some archetype has every component in with, which a with of 0 always is.
+bool World::SharesEntities(ComponentMask with) const {
+	if (with == 0) {
+		return true;
+	}
+	for (size_t i = 0; i < archetypes.size(); i++) {
+		if ((archetypes[i].mask & with) == with) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool World::Conflicts(const System &a, const System &b) const {
+	for (size_t i = 0; i < a.access.size(); i++) {
+		for (size_t j = 0; j < b.access.size(); j++) {
+			const SystemAccess &x = a.access[i];
+			const SystemAccess &y = b.access[j];
+			bool overlap = (x.writes & (y.reads | y.writes)) != 0 || (y.writes & x.reads) != 0;
+			if (overlap && SharesEntities(x.with | y.with)) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void World::BuildSchedule() {
+	// Each system goes in the batch after the last earlier system it conflicts with,
+	// so the result of running the batches matches running the systems in order
+	batches.clear();
+	std::vector<int> batchOf(systems.size());
+	for (size_t i = 0; i < systems.size(); i++) {
+		int batch = 0;
+		for (size_t j = 0; j < i; j++) {
+			if (Conflicts(systems[i], systems[j]) && batchOf[j] + 1 > batch) {
+				batch = batchOf[j] + 1;
+			}
+		}
+		batchOf[i] = batch;
+		if (batch == (int) batches.size()) {
+			batches.push_back(std::vector<int>());
+		}
+		batches[batch].push_back((int) i);
+	}
+}
+
+void World::StartWorkers() {
+	unsigned int count = std::thread::hardware_concurrency();
+	count = count > 1 ? count - 1 : 1;
+	for (unsigned int i = 0; i < count; i++) {
+		workers.push_back(std::thread(&World::WorkerLoop, this));
+	}
+}
+
+void World::WorkerLoop() {
+	std::unique_lock<std::mutex> lock(poolMutex);
+	unsigned int seen = batchGeneration;
+	while (true) {
+		workReady.wait(lock, [this, seen] { return stopping || batchGeneration != seen; });
+		if (stopping) {
+			return;
+		}
+		seen = batchGeneration;
+		RunJobs(lock);
+	}
+}
+
+// Takes systems of the current batch until none are left. Called with the lock held.
+void World::RunJobs(std::unique_lock<std::mutex> &lock) {
+	while (nextJob < jobs.size()) {
+		System &system = systems[jobs[nextJob++]];
+		float elapsed = jobElapsed;
+		lock.unlock();
+		system.run(*this, elapsed);
+		lock.lock();
+		if (--pendingJobs == 0) {
+			batchDone.notify_all();
+		}
+	}
+}
+
+void World::Run(float elapsed) {
+	for (size_t i = 0; i < batches.size(); i++) {
+		const std::vector<int> &batch = batches[i];
+		if (!parallel || batch.size() == 1) {
+			for (size_t j = 0; j < batch.size(); j++) {
+				systems[batch[j]].run(*this, elapsed);
+			}
+			continue;
+		}
+		if (workers.empty()) {
+			StartWorkers();
+		}
+
+		std::unique_lock<std::mutex> lock(poolMutex);
+		jobs.clear();
+		for (size_t j = 0; j < batch.size(); j++) {
+			if (!systems[batch[j]].mainThread) {
+				jobs.push_back(batch[j]);
+			}
+		}
+		nextJob = 0;
+		pendingJobs = jobs.size();
+		jobElapsed = elapsed;
+		batchGeneration++;
+		lock.unlock();
+		workReady.notify_all();
+
+		for (size_t j = 0; j < batch.size(); j++) {
+			if (systems[batch[j]].mainThread) {
+				systems[batch[j]].run(*this, elapsed);
+			}
+		}
+
+		// The calling thread helps with what is left, then waits for the whole batch
+		lock.lock();
+		RunJobs(lock);
+		batchDone.wait(lock, [this] { return pendingJobs == 0; });
+	}
+}
+
+void World::PrintSchedule() const {
+	for (size_t i = 0; i < batches.size(); i++) {
+		std::cout << "batch " << i << ":";
+		for (size_t j = 0; j < batches[i].size(); j++) {
+			std::cout << " " << systems[batches[i][j]].name;
+		}
+		std::cout << std::endl;
+	}
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#define MAX_COMPONENTS 32
+#define CHUNK_BYTES (16 * 1024)
+#define CHUNK_ALIGNMENT 16
+
+typedef unsigned int ComponentMask;
+typedef unsigned int EntityID;
+
+// Every component struct declares a unique index: static const int type = ...;
+#define COMPONENT(T) (1u << T::type)
+
+struct Chunk {
+	unsigned char *data;
+	int count;
+};
+
+// Entities with exactly the same set of components. Each chunk stores one array
+// per component followed by the owning entity IDs, so queries walk memory linearly.
+struct Archetype {
+	ComponentMask mask;
+	int capacity;
+	size_t offsets[MAX_COMPONENTS];
+	size_t entityOffset;
+	std::vector<Chunk> chunks;
+};
+
+class ChunkView {
+public:
+	ChunkView(Archetype &archetype, Chunk &chunk) : archetype(archetype), chunk(chunk) {}
+
+	int Count() const { return chunk.count; }
+	template <typename T>
+	T *Get() const { return (T *) (chunk.data + archetype.offsets[T::type]); }
+	bool Has(ComponentMask mask) const { return (archetype.mask & mask) == mask; }
+	EntityID Entity(int row) const { return ((EntityID *) (chunk.data + archetype.entityOffset))[row]; }
+
+private:
+	Archetype &archetype;
+	Chunk &chunk;
+};
+
+class World;
+
+// What a system reads and writes on the entities that have every component in
+// with, the same entities a Query for with visits. A with of 0 covers every
+// entity as well as state outside the world.
+struct SystemAccess {
+	ComponentMask with;
+	ComponentMask reads;
+	ComponentMask writes;
+};
+
+// A system declares which components it reads and writes. Systems whose access
+// does not conflict are put in the same batch and may run at the same time;
+// mainThread systems (anything touching GL) always run on the calling thread.
+// Two systems may write the same component at once when no archetype matches
+// both of their with masks, such as paddles and the ball.
+// State outside the world, such as globals or a single producer queue, gets a
+// type index of its own that no entity carries, and systems that touch it name
+// it in their masks like a component. Systems must not create or destroy entities.
+struct System {
+	const char *name;
+	std::vector<SystemAccess> access;
+	bool mainThread;
+	std::function<void(World &, float)> run;
+};
+
+class World {
+public:
+	World();
+	~World();
+
+	template <typename T>
+	void RegisterComponent() { componentSizes[T::type] = std::is_empty<T>::value ? 0 : sizeof(T); }
+
+	EntityID Create(ComponentMask mask);
+	void Destroy(EntityID entity);
+	bool Has(EntityID entity, ComponentMask mask) const;
+	template <typename T>
+	T *Get(EntityID entity);
+
+	void Query(ComponentMask mask, const std::function<void(ChunkView &)> &callback);
+
+	void AddSystem(const char *name, ComponentMask reads, ComponentMask writes, const std::function<void(World &, float)> &run, bool mainThread = false);
+	void AddSystem(const char *name, const std::vector<SystemAccess> &access, const std::function<void(World &, float)> &run, bool mainThread = false);
+	void Run(float elapsed);
+	void PrintSchedule() const;
+
+	bool parallel = false;
+
+private:
+	World(const World &);
+	World &operator=(const World &);
+
+	struct Location {
+		int archetype;
+		int chunk;
+		int row;
+	};
+
+	int FindArchetype(ComponentMask mask);
+	bool SharesEntities(ComponentMask with) const;
+	bool Conflicts(const System &a, const System &b) const;
+	void BuildSchedule();
+
+	size_t componentSizes[MAX_COMPONENTS];
+	std::vector<Archetype> archetypes;
+	std::vector<Location> locations;
+	std::vector<EntityID> freeEntities;
+
+	std::vector<System> systems;
+	std::vector<std::vector<int> > batches;
+
+	// Workers are started the first time a batch has more than one system to run
+	// and wait between batches instead of being created for each one.
+	void StartWorkers();
+	void WorkerLoop();
+	void RunJobs(std::unique_lock<std::mutex> &lock);
+
+	std::vector<std::thread> workers;
+	std::mutex poolMutex;
+	std::condition_variable workReady;
+	std::condition_variable batchDone;
+	std::vector<int> jobs;
+	size_t nextJob = 0;
+	size_t pendingJobs = 0;
+	unsigned int batchGeneration = 0;
+	float jobElapsed = 0.0f;
+	bool stopping = false;
+};
+
+template <typename T>
+T *World::Get(EntityID entity) {
+	const Location &location = locations[entity];
+	if (location.archetype < 0 || !(archetypes[location.archetype].mask & COMPONENT(T))) {
+		return NULL;
+	}
+	Archetype &archetype = archetypes[location.archetype];
+	return (T *) (archetype.chunks[location.chunk].data + archetype.offsets[T::type]) + location.row;
+}
@@ -17,56 +17,58 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #include "ShaderProgram.h"
+#include "AudioMixer.h"
+#include "World.h"
 #include "glm/mat4x4.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 
-class Entity {
-public:
-	void draw(ShaderProgram &p);
-	void move(float elapsed);
-	void setColor(float r, float g, float b, float a);
-
-	int textureID;
+struct Transform {
+	static const int type = 0;
 	float x;
 	float y;
 	float width;
 	float height;
-	float r, g, b, a;
+};
 
-	float rotation = 0.0f;
-	float velocity = 1.0f;
-	float direction_x = 0.0f;
-	float direction_y = 0.0f;
+struct Motion {
+	static const int type = 1;
+	float velocity;
+	float direction_x;
+	float direction_y;
 };
 
-void Entity::draw(ShaderProgram &program) {
-	float vertices[] = { -0.5, -0.5, 0.5, -0.5, 0.5, 0.5, -0.5, -0.5, 0.5, 0.5, -0.5, 0.5 };
-	glVertexAttribPointer(program.positionAttribute, 2, GL_FLOAT, false, 0, vertices);
-	glEnableVertexAttribArray(program.positionAttribute);
+struct Color {
+	static const int type = 2;
+	float r, g, b, a;
+};
 
-	glm::mat4 modelMatrix = glm::mat4(1.0f);
-	modelMatrix = glm::translate(modelMatrix, glm::vec3(x, y, 0.0f));
-	modelMatrix = glm::scale(modelMatrix, glm::vec3(width, height, 1.0f));
-	program.SetModelMatrix(modelMatrix);
-	program.SetColor(r, g, b, a);
+struct PaddleControl {
+	static const int type = 3;
+	SDL_Scancode up;
+	SDL_Scancode down;
+	float home_x;
+};
 
-	glDrawArrays(GL_TRIANGLES, 0, 6);
-	glDisableVertexAttribArray(program.positionAttribute);
-}
+struct Ball {
+	static const int type = 4;
+};
 
-void Entity::move(float elapsed) {
-	this->x = this->x + (this->direction_x * elapsed * this->velocity);
-	this->y = this->y + (this->direction_y * elapsed * this->velocity);
-}
+struct Wall {
+	static const int type = 5;
+};
 
-void Entity::setColor(float r, float g, float b, float a) {
-	this->r = r;
-	this->g = g;
-	this->b = b;
-	this->a = a;
-}
+// Never attached to entities: they stand for state outside the world in the
+// systems' masks. GameFlow is counter, restart, game_end and lastFrameTicks,
+// Sound the audio command queue, which only one thread may push to at a time.
+struct GameFlow {
+	static const int type = 6;
+};
 
-bool collision(Entity &a, Entity &b, float space) {
+struct Sound {
+	static const int type = 7;
+};
+
+bool collision(const Transform &a, const Transform &b, float space) {
 	float distance_between_x = abs(a.x - b.x) - ((a.width + b.width) / 2);
 	float distance_between_y = abs(a.y - b.y) - ((a.height + b.height) / 2);
 	if (distance_between_x < space && distance_between_y < space) {
@@ -75,39 +77,217 @@ bool collision(Entity &a, Entity &b, float space) {
 	return false;
 }
 
-bool outOfBound(Entity &ball) {
+bool outOfBound(const Transform &ball) {
 	if (abs(ball.x) > 2.0f) {
 		return true;
 	}
 	return false;
 }
 
-void resetGame(Entity &leftPaddle, Entity &rightPaddle, Entity &ball) {
-	leftPaddle.x = -1.72f;
-	leftPaddle.y = 0.0f;
-
-	rightPaddle.x = 1.72f;
-	rightPaddle.y = 0.0f;
-
-	ball.x = 0.0f;
-	ball.y = 0.0f;
-	ball.direction_x = 0.0f;
-	ball.direction_y = 0.0f;
-	ball.velocity = 1.0f;
+void serveBall(Motion &motion) {
+	int rand_x = rand() % 10;
+	motion.direction_x = 1.0f ? -1.0f : rand_x >= 4;
+	int rand_y = rand() % 13 - 6;
+	motion.direction_y = rand_y / 10.0f;
 }
 
 SDL_Window* displayWindow;
 SDL_GLContext context;
 ShaderProgram program;
+AudioMixer audio;
+int paddleSound, wallSound, scoreSound;
 const Uint8 *keys;
 bool done = false;
 bool restart = false;
 float game_end;
 float counter = 0.0f;
 glm::mat4 projectionMatrix, viewMatrix;
-Entity leftPaddle, rightPaddle, ball, topBar, bottomBar;
+World world;
 float lastFrameTicks = 0.0f;
 
+void inputSystem(World &world, float) {
+	world.Query(COMPONENT(PaddleControl) | COMPONENT(Motion), [](ChunkView &chunk) {
+		PaddleControl *control = chunk.Get<PaddleControl>();
+		Motion *motion = chunk.Get<Motion>();
+		for (int i = 0; i < chunk.Count(); i++) {
+			if (keys[control[i].up]) {
+				motion[i].direction_y = 1.5f;
+			} else if (keys[control[i].down]) {
+				motion[i].direction_y = -1.5f;
+			} else {
+				motion[i].direction_y = 0.0f;
+			}
+		}
+	});
+}
+
+void serveSystem(World &world, float) {
+	world.Query(COMPONENT(Ball) | COMPONENT(Motion), [](ChunkView &chunk) {
+		Motion *motion = chunk.Get<Motion>();
+		for (int i = 0; i < chunk.Count(); i++) {
+			if (motion[i].velocity <= 1.5f) {
+				motion[i].velocity = (float) (1000.0f + counter) / 1000.0f;
+				counter = counter + 1.0f;
+			}
+			if (restart && (abs(lastFrameTicks - game_end) > 2.0f)) {
+				serveBall(motion[i]);
+				restart = false;
+			}
+		}
+	});
+}
+
+void movementSystem(World &world, float elapsed) {
+	world.Query(COMPONENT(Transform) | COMPONENT(Motion), [elapsed](ChunkView &chunk) {
+		Transform *transform = chunk.Get<Transform>();
+		Motion *motion = chunk.Get<Motion>();
+		for (int i = 0; i < chunk.Count(); i++) {
+			transform[i].x = transform[i].x + (motion[i].direction_x * elapsed * motion[i].velocity);
+			transform[i].y = transform[i].y + (motion[i].direction_y * elapsed * motion[i].velocity);
+		}
+	});
+}
+
+void paddleWallSystem(World &world, float elapsed) {
+	world.Query(COMPONENT(PaddleControl) | COMPONENT(Transform) | COMPONENT(Motion), [&world, elapsed](ChunkView &chunk) {
+		Transform *transform = chunk.Get<Transform>();
+		Motion *motion = chunk.Get<Motion>();
+		for (int i = 0; i < chunk.Count(); i++) {
+			Transform &paddle = transform[i];
+			bool hit = false;
+			world.Query(COMPONENT(Wall) | COMPONENT(Transform), [&paddle, &hit](ChunkView &walls) {
+				Transform *wall = walls.Get<Transform>();
+				for (int j = 0; j < walls.Count(); j++) {
+					hit = hit || collision(paddle, wall[j], 0.02f);
+				}
+			});
+			// Undo this frame's movement
+			if (hit) {
+				paddle.x = paddle.x - (motion[i].direction_x * elapsed * motion[i].velocity);
+				paddle.y = paddle.y - (motion[i].direction_y * elapsed * motion[i].velocity);
+			}
+		}
+	});
+}
+
+void ballCollisionSystem(World &world, float) {
+	world.Query(COMPONENT(Ball) | COMPONENT(Transform) | COMPONENT(Motion), [&world](ChunkView &chunk) {
+		Transform *transform = chunk.Get<Transform>();
+		Motion *motion = chunk.Get<Motion>();
+		for (int i = 0; i < chunk.Count(); i++) {
+			Transform &ball = transform[i];
+			Motion &ballMotion = motion[i];
+
+			bool hitWall = false;
+			world.Query(COMPONENT(Wall) | COMPONENT(Transform), [&ball, &hitWall](ChunkView &walls) {
+				Transform *wall = walls.Get<Transform>();
+				for (int j = 0; j < walls.Count(); j++) {
+					hitWall = hitWall || collision(ball, wall[j], 0.005f);
+				}
+			});
+			if (hitWall) {
+				ballMotion.direction_y = -ballMotion.direction_y;
+				audio.Play(wallSound, 1);
+			}
+
+			const Transform *hitPaddle = NULL;
+			world.Query(COMPONENT(PaddleControl) | COMPONENT(Transform), [&ball, &hitPaddle](ChunkView &paddles) {
+				Transform *paddle = paddles.Get<Transform>();
+				for (int j = 0; j < paddles.Count() && hitPaddle == NULL; j++) {
+					if (collision(ball, paddle[j], 0.005f)) {
+						hitPaddle = &paddle[j];
+					}
+				}
+			});
+			if (hitPaddle != NULL) {
+				ballMotion.direction_x = -ballMotion.direction_x;
+				audio.Play(paddleSound, 2);
+				float distance_from_center = ball.y - hitPaddle->y;
+				ballMotion.direction_y = distance_from_center / (hitPaddle->height / 2) * 0.6f;
+			}
+		}
+	});
+}
+
+void scoreSystem(World &world, float) {
+	bool scored = false;
+	float ball_x = 0.0f;
+	world.Query(COMPONENT(Ball) | COMPONENT(Transform), [&scored, &ball_x](ChunkView &chunk) {
+		Transform *transform = chunk.Get<Transform>();
+		for (int i = 0; i < chunk.Count(); i++) {
+			if (outOfBound(transform[i])) {
+				scored = true;
+				ball_x = transform[i].x;
+			}
+		}
+	});
+	if (!scored) {
+		return;
+	}
+
+	// The walls take the color of the player on the other side from where the ball left
+	Color winner = {};
+	world.Query(COMPONENT(PaddleControl) | COMPONENT(Transform) | COMPONENT(Color), [ball_x, &winner](ChunkView &chunk) {
+		PaddleControl *control = chunk.Get<PaddleControl>();
+		Transform *transform = chunk.Get<Transform>();
+		Color *color = chunk.Get<Color>();
+		for (int i = 0; i < chunk.Count(); i++) {
+			if ((control[i].home_x < 0.0f) == (ball_x > 0.0f)) {
+				winner = color[i];
+			}
+			transform[i].x = control[i].home_x;
+			transform[i].y = 0.0f;
+		}
+	});
+	world.Query(COMPONENT(Wall) | COMPONENT(Color), [&winner](ChunkView &chunk) {
+		Color *color = chunk.Get<Color>();
+		for (int i = 0; i < chunk.Count(); i++) {
+			color[i] = winner;
+		}
+	});
+	world.Query(COMPONENT(Ball) | COMPONENT(Transform) | COMPONENT(Motion), [](ChunkView &chunk) {
+		Transform *transform = chunk.Get<Transform>();
+		Motion *motion = chunk.Get<Motion>();
+		for (int i = 0; i < chunk.Count(); i++) {
+			transform[i].x = 0.0f;
+			transform[i].y = 0.0f;
+			motion[i].direction_x = 0.0f;
+			motion[i].direction_y = 0.0f;
+			motion[i].velocity = 1.0f;
+		}
+	});
+
+	audio.Play(scoreSound, 3);
+	game_end = lastFrameTicks;
+	counter = 0.0f;
+	restart = true;
+}
+
+EntityID createRect(ComponentMask components, float x, float y, float width, float height, float r, float g, float b) {
+	EntityID entity = world.Create(COMPONENT(Transform) | COMPONENT(Color) | components);
+	Transform *transform = world.Get<Transform>(entity);
+	transform->x = x;
+	transform->y = y;
+	transform->width = width;
+	transform->height = height;
+	Color *color = world.Get<Color>(entity);
+	color->r = r;
+	color->g = g;
+	color->b = b;
+	color->a = 1.0f;
+	return entity;
+}
+
+EntityID createPaddle(float x, SDL_Scancode up, SDL_Scancode down, float r, float g, float b) {
+	EntityID paddle = createRect(COMPONENT(Motion) | COMPONENT(PaddleControl), x, 0.0f, 0.04f, 0.33f, r, g, b);
+	world.Get<Motion>(paddle)->velocity = 1.0f;
+	PaddleControl *control = world.Get<PaddleControl>(paddle);
+	control->up = up;
+	control->down = down;
+	control->home_x = x;
+	return paddle;
+}
+
 void Setup() {
 	SDL_Init(SDL_INIT_VIDEO);
 	displayWindow = SDL_CreateWindow("Pong Game", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 640, 360, SDL_WINDOW_OPENGL);
@@ -118,42 +298,53 @@ void Setup() {
 	glewInit();
 #endif
 
+	audio.Open();
+	paddleSound = audio.LoadSample(RESOURCE_FOLDER"assets/sounds/paddle.wav");
+	wallSound = audio.LoadSample(RESOURCE_FOLDER"assets/sounds/wall.wav");
+	scoreSound = audio.LoadSample(RESOURCE_FOLDER"assets/sounds/score.wav");
+
 	glViewport(0, 0, 640, 360);
 	program.Load(RESOURCE_FOLDER"vertex.glsl", RESOURCE_FOLDER"fragment.glsl");
 
-	leftPaddle.x = -1.72f;
-	leftPaddle.y = 0.0f;
-	leftPaddle.width = 0.04f;
-	leftPaddle.height = 0.33f;
-	leftPaddle.setColor(255.0f, 0.0f, 0.0f, 1.0f);
-
-	rightPaddle.x = 1.72f;
-	rightPaddle.y = 0.0f;
-	rightPaddle.width = 0.04f;
-	rightPaddle.height = 0.33f;
-	rightPaddle.setColor(0.0f, 0.0f, 255.0f, 1.0f);
-
-	ball.x = 0.0f;
-	ball.y = 0.0f;
-	ball.width = 0.05f;
-	ball.height = 0.05f;
-	ball.setColor(255.0f, 255.0f, 255.0f, 1.0f);
-	int rand_x = rand() % 10;
-	ball.direction_x = 1.0f ? -1.0f : rand_x >= 4;
-	int rand_y = rand() % 13 - 6;
-	ball.direction_y = rand_y / 10.0f;
-
-	topBar.x = 0.0f;
-	topBar.y = 0.95f;
-	topBar.width = 3.75f;
-	topBar.height = 0.04f;
-	topBar.setColor(255.0f, 255.0f, 255.0f, 1.0f);
-
-	bottomBar.x = 0.0f;
-	bottomBar.y = -0.95f;
-	bottomBar.width = 3.75f;
-	bottomBar.height = 0.04f;
-	bottomBar.setColor(255.0f, 255.0f, 255.0f, 1.0f);
+	world.RegisterComponent<Transform>();
+	world.RegisterComponent<Motion>();
+	world.RegisterComponent<Color>();
+	world.RegisterComponent<PaddleControl>();
+	world.RegisterComponent<Ball>();
+	world.RegisterComponent<Wall>();
+
+	createPaddle(-1.72f, SDL_SCANCODE_W, SDL_SCANCODE_S, 255.0f, 0.0f, 0.0f);
+	createPaddle(1.72f, SDL_SCANCODE_UP, SDL_SCANCODE_DOWN, 0.0f, 0.0f, 255.0f);
+
+	EntityID ball = createRect(COMPONENT(Motion) | COMPONENT(Ball), 0.0f, 0.0f, 0.05f, 0.05f, 255.0f, 255.0f, 255.0f);
+	world.Get<Motion>(ball)->velocity = 1.0f;
+	serveBall(*world.Get<Motion>(ball));
+
+	// The bars have no Motion, so no system that moves things ever visits them
+	createRect(COMPONENT(Wall), 0.0f, 0.95f, 3.75f, 0.04f, 255.0f, 255.0f, 255.0f);
+	createRect(COMPONENT(Wall), 0.0f, -0.95f, 3.75f, 0.04f, 255.0f, 255.0f, 255.0f);
+
+	// Per kind of entity, so systems that write the same component on paddles and on the ball can share a batch
+	world.AddSystem("input", {
+		{ COMPONENT(PaddleControl), COMPONENT(PaddleControl), COMPONENT(Motion) } }, inputSystem);
+	world.AddSystem("serve", {
+		{ COMPONENT(Ball), COMPONENT(Motion), COMPONENT(Motion) },
+		{ 0, 0, COMPONENT(GameFlow) } }, serveSystem);
+	world.AddSystem("movement", {
+		{ COMPONENT(Motion), COMPONENT(Motion), COMPONENT(Transform) } }, movementSystem);
+	world.AddSystem("paddleWall", {
+		{ COMPONENT(PaddleControl), COMPONENT(Motion) | COMPONENT(Transform), COMPONENT(Transform) },
+		{ COMPONENT(Wall), COMPONENT(Transform), 0 } }, paddleWallSystem);
+	world.AddSystem("ballCollision", {
+		{ COMPONENT(Ball), COMPONENT(Transform) | COMPONENT(Motion), COMPONENT(Motion) },
+		{ COMPONENT(Wall), COMPONENT(Transform), 0 },
+		{ COMPONENT(PaddleControl), COMPONENT(Transform), 0 },
+		{ 0, 0, COMPONENT(Sound) } }, ballCollisionSystem);
+	world.AddSystem("score", {
+		{ COMPONENT(Ball), COMPONENT(Transform), COMPONENT(Transform) | COMPONENT(Motion) },
+		{ COMPONENT(PaddleControl), COMPONENT(PaddleControl) | COMPONENT(Color), COMPONENT(Transform) },
+		{ COMPONENT(Wall), 0, COMPONENT(Color) },
+		{ 0, 0, COMPONENT(GameFlow) | COMPONENT(Sound) } }, scoreSystem);
 
 	projectionMatrix = glm::mat4(1.0f);
 	projectionMatrix = glm::ortho(-1.777f, 1.777f, -1.0f, 1.0f, -1.0f, 1.0f);
@@ -174,22 +365,6 @@ void ProcessEvents() {
 			done = true;
 		}
 	}
-
-	if (keys[SDL_SCANCODE_UP]) {
-		rightPaddle.direction_y = 1.5f;
-	} else if (keys[SDL_SCANCODE_DOWN]) {
-		rightPaddle.direction_y = -1.5f;
-	} else {
-		rightPaddle.direction_y = 0.0f;
-	}
-
-	if (keys[SDL_SCANCODE_W]) {
-		leftPaddle.direction_y = 1.5f;
-	} else if (keys[SDL_SCANCODE_S]) {
-		leftPaddle.direction_y = -1.5f;
-	} else {
-		leftPaddle.direction_y = 0.0f;
-	}
 }
 
 void Update() {
@@ -197,81 +372,47 @@ void Update() {
 	float elapsed = ticks - lastFrameTicks;
 	lastFrameTicks = ticks;
 
-	if (ball.velocity <= 1.5f) {
-		ball.velocity = (float) (1000.0f + counter) / 1000.0f;
-		counter = counter + 1.0f;
-	}
-
-	leftPaddle.move(elapsed);
-	rightPaddle.move(elapsed);
-	ball.move(elapsed);
-
-	if (restart && (abs(lastFrameTicks - game_end) > 2.0f)) {
-		int rand_x = rand() % 10;
-		ball.direction_x = 1.0f ? -1.0f : rand_x >= 4;
-		int rand_y = rand() % 13 - 6;
-		ball.direction_y = rand_y / 10.0f;
-		restart = false;
-	}
-
-	// Check collision
-	if (collision(leftPaddle, topBar, 0.02f) || collision(leftPaddle, bottomBar, 0.02f)) {
-		leftPaddle.move(-1.0f * elapsed);
-	}
-
-	if (collision(rightPaddle, topBar, 0.02f) || collision(rightPaddle, bottomBar, 0.02f)) {
-		rightPaddle.move(-1.0f * elapsed);
-	}
-
-	if (collision(ball, topBar, 0.005f) || collision(ball, bottomBar, 0.005f)) {
-		ball.direction_y = -ball.direction_y;
-	}
-
-	if (collision(ball, leftPaddle, 0.005f) || collision(ball, rightPaddle, 0.005f)) {
-		ball.direction_x = -ball.direction_x;
-		if (collision(ball, leftPaddle, 0.005f)) {
-			float distance_from_center = ball.y - leftPaddle.y;
-			ball.direction_y = distance_from_center / (leftPaddle.height / 2) * 0.6f;
-		} else if (collision(ball, rightPaddle, 0.005f)){
-			float distance_from_center = ball.y - rightPaddle.y;
-			ball.direction_y = distance_from_center / (rightPaddle.height / 2) * 0.6f;
-		}
-	}
-
-	// Check winning conditions
-	if (outOfBound(ball)) {
-		if (ball.x > 0) {
-			topBar.setColor(255.0f, 0.0f, 0.0f, 1.0f);
-			bottomBar.setColor(255.0f, 0.0f, 0.0f, 1.0f);
-		} else {
-			topBar.setColor(0.0f, 0.0f, 255.0f, 1.0f);
-			bottomBar.setColor(0.0f, 0.0f, 255.0f, 1.0f);
-		}
-		resetGame(leftPaddle, rightPaddle, ball);
-		game_end = lastFrameTicks;
-		counter = 0.0f;
-		restart = true;
-	}
+	world.Run(elapsed);
 }
 
 void Render() {
 	glClear(GL_COLOR_BUFFER_BIT);
+	float vertices[] = { -0.5, -0.5, 0.5, -0.5, 0.5, 0.5, -0.5, -0.5, 0.5, 0.5, -0.5, 0.5 };
+	glVertexAttribPointer(program.positionAttribute, 2, GL_FLOAT, false, 0, vertices);
+	glEnableVertexAttribArray(program.positionAttribute);
+
+	world.Query(COMPONENT(Transform) | COMPONENT(Color), [](ChunkView &chunk) {
+		Transform *transform = chunk.Get<Transform>();
+		Color *color = chunk.Get<Color>();
+		for (int i = 0; i < chunk.Count(); i++) {
+			glm::mat4 modelMatrix = glm::mat4(1.0f);
+			modelMatrix = glm::translate(modelMatrix, glm::vec3(transform[i].x, transform[i].y, 0.0f));
+			modelMatrix = glm::scale(modelMatrix, glm::vec3(transform[i].width, transform[i].height, 1.0f));
+			program.SetModelMatrix(modelMatrix);
+			program.SetColor(color[i].r, color[i].g, color[i].b, color[i].a);
+			glDrawArrays(GL_TRIANGLES, 0, 6);
+		}
+	});
 
-	leftPaddle.draw(program);
-	rightPaddle.draw(program);
-	ball.draw(program);
-	topBar.draw(program);
-	bottomBar.draw(program);
+	glDisableVertexAttribArray(program.positionAttribute);
 
 	SDL_GL_SwapWindow(displayWindow);
 }
 
 void Cleanup() {
-
+	audio.Close();
 }
 
 int main(int argc, char *argv[]) {
+	for (int i = 1; i < argc; i++) {
+		if (std::string(argv[i]) == "--parallel-systems") {
+			world.parallel = true;
+		}
+	}
 	Setup();
+	if (world.parallel) {
+		world.PrintSchedule();
+	}
 	while (!done) {
 		ProcessEvents();
 		Update();
@@ -0,0 +1,110 @@
+
+#include "Affine2D.h"
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define AFFINE_SSE2
+	#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#define AFFINE_NEON
+	#include <arm_neon.h>
+#endif
+
+Affine2D Affine2D::Make(float x, float y, float rotation, float scaleX, float scaleY) {
+	Affine2D transform;
+	float cosine = 1.0f;
+	float sine = 0.0f;
+	if (rotation != 0.0f) {
+		cosine = cosf(rotation);
+		sine = sinf(rotation);
+	}
+	transform.a = cosine * scaleX;
+	transform.b = sine * scaleX;
+	transform.c = -sine * scaleY;
+	transform.d = cosine * scaleY;
+	transform.tx = x;
+	transform.ty = y;
+	return transform;
+}
+
+void Affine2D::Apply(float x, float y, float &outX, float &outY) const {
+	outX = a * x + c * y + tx;
+	outY = b * x + d * y + ty;
+}
+
+Affine2D Affine2D::operator*(const Affine2D &other) const {
+	Affine2D result;
+	result.a = a * other.a + c * other.b;
+	result.b = b * other.a + d * other.b;
+	result.c = a * other.c + c * other.d;
+	result.d = b * other.c + d * other.d;
+	result.tx = a * other.tx + c * other.ty + tx;
+	result.ty = b * other.tx + d * other.ty + ty;
+	return result;
+}
+
+// Corners in the order (-1, -1), (1, 1), (-1, 1), (1, -1); the triangles use them as 0 1 2, 1 0 3.
+void TransformQuadsScalar(const Affine2D *transforms, int count, float *vertices) {
+	for (int i = 0; i < count; i++) {
+		const Affine2D &t = transforms[i];
+		float x0 = t.tx - t.a - t.c, y0 = t.ty - t.b - t.d;
+		float x1 = t.tx + t.a + t.c, y1 = t.ty + t.b + t.d;
+		float x2 = t.tx - t.a + t.c, y2 = t.ty - t.b + t.d;
+		float x3 = t.tx + t.a - t.c, y3 = t.ty + t.b - t.d;
+		float *v = vertices + i * 12;
+		v[0] = x0; v[1] = y0; v[2] = x1; v[3] = y1;
+		v[4] = x2; v[5] = y2; v[6] = x1; v[7] = y1;
+		v[8] = x0; v[9] = y0; v[10] = x3; v[11] = y3;
+	}
+}
+
+#if defined(AFFINE_SSE2)
+
+void TransformQuads(const Affine2D *transforms, int count, float *vertices) {
+	const __m128 cornerX = _mm_setr_ps(-1.0f, 1.0f, -1.0f, 1.0f);
+	const __m128 cornerY = _mm_setr_ps(-1.0f, 1.0f, 1.0f, -1.0f);
+	for (int i = 0; i < count; i++) {
+		const Affine2D &t = transforms[i];
+		__m128 x = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.a), cornerX), _mm_mul_ps(_mm_set1_ps(t.c), cornerY)), _mm_set1_ps(t.tx));
+		__m128 y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.b), cornerX), _mm_mul_ps(_mm_set1_ps(t.d), cornerY)), _mm_set1_ps(t.ty));
+		__m128 corners01 = _mm_unpacklo_ps(x, y);
+		__m128 corners23 = _mm_unpackhi_ps(x, y);
+		float *v = vertices + i * 12;
+		_mm_storeu_ps(v, corners01);
+		_mm_storeu_ps(v + 4, _mm_shuffle_ps(corners23, corners01, _MM_SHUFFLE(3, 2, 1, 0)));
+		_mm_storeu_ps(v + 8, _mm_shuffle_ps(corners01, corners23, _MM_SHUFFLE(3, 2, 1, 0)));
+	}
+}
+
+const char *Affine2DPath() { return "sse2"; }
+
+#elif defined(AFFINE_NEON)
+
+void TransformQuads(const Affine2D *transforms, int count, float *vertices) {
+	static const float cornerXValues[] = { -1.0f, 1.0f, -1.0f, 1.0f };
+	static const float cornerYValues[] = { -1.0f, 1.0f, 1.0f, -1.0f };
+	const float32x4_t cornerX = vld1q_f32(cornerXValues);
+	const float32x4_t cornerY = vld1q_f32(cornerYValues);
+	for (int i = 0; i < count; i++) {
+		const Affine2D &t = transforms[i];
+		float32x4_t x = vmlaq_n_f32(vmlaq_n_f32(vdupq_n_f32(t.tx), cornerX, t.a), cornerY, t.c);
+		float32x4_t y = vmlaq_n_f32(vmlaq_n_f32(vdupq_n_f32(t.ty), cornerX, t.b), cornerY, t.d);
+		float32x4x2_t corners = vzipq_f32(x, y);
+		float *v = vertices + i * 12;
+		vst1q_f32(v, corners.val[0]);
+		vst1q_f32(v + 4, vcombine_f32(vget_low_f32(corners.val[1]), vget_high_f32(corners.val[0])));
+		vst1q_f32(v + 8, vcombine_f32(vget_low_f32(corners.val[0]), vget_high_f32(corners.val[1])));
+	}
+}
+
+const char *Affine2DPath() { return "neon"; }
+
+#else
+
+void TransformQuads(const Affine2D *transforms, int count, float *vertices) {
+	TransformQuadsScalar(transforms, count, vertices);
+}
+
+const char *Affine2DPath() { return "scalar"; }
+
+#endif
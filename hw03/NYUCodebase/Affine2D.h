@@ -0,0 +1,25 @@
+#pragma once
+
+// A 2D transform as the top two rows of a 3x3 matrix:
+// x' = a * x + c * y + tx
+// y' = b * x + d * y + ty
+// Six floats instead of the sixteen of a glm::mat4, and applying one to a point
+// takes four multiplies instead of sixteen.
+struct Affine2D {
+	float a, b, c, d;
+	float tx, ty;
+
+	static Affine2D Make(float x, float y, float rotation, float scaleX, float scaleY);
+	void Apply(float x, float y, float &outX, float &outY) const;
+	// Applies other first, then this.
+	Affine2D operator*(const Affine2D &other) const;
+};
+
+// Writes two triangles per transform by mapping the corners of the quad from
+// (-1, -1) to (1, 1), in the vertex order SpriteTable uses, so 12 floats each.
+// Scaling a transform by a sprite's half extents makes the quad that sprite.
+void TransformQuads(const Affine2D *transforms, int count, float *vertices);
+void TransformQuadsScalar(const Affine2D *transforms, int count, float *vertices);
+
+// Name of the SIMD path TransformQuads was compiled with ("sse2", "neon" or "scalar").
+const char *Affine2DPath();
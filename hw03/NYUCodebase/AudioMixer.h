@@ -0,0 +1,101 @@
+#pragma once
+
+#include <SDL.h>
+#include <SDL_mixer.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#define MAX_VOICES 16
+#define AUDIO_COMMAND_QUEUE_SIZE 256
+#define AUDIO_MAX_BUFFER_FRAMES 4096
+
+struct AudioCommand {
+	enum Type { PLAY, STOP_ALL };
+
+	Type type;
+	int sample;
+	int priority;
+	int volume;
+	Uint64 issued;
+};
+
+// Single producer (game code), single consumer (audio callback) ring buffer.
+class AudioCommandQueue {
+public:
+	bool Push(const AudioCommand &command);
+	bool Pop(AudioCommand &command);
+
+private:
+	AudioCommand commands[AUDIO_COMMAND_QUEUE_SIZE];
+	std::atomic<unsigned int> head{ 0 };
+	std::atomic<unsigned int> tail{ 0 };
+};
+
+struct AudioVoice {
+	bool active;
+	int sample;
+	int frame;
+	int priority;
+	int volume;
+	Uint64 started;
+};
+
+struct AudioStats {
+	Uint64 callbacks;
+	Uint64 mixedFrames;
+	double mixSeconds;
+	Uint64 played;
+	Uint64 stolen;
+	Uint64 dropped;
+	double averageLatency;
+	double maxLatency;
+	double bufferLatency;
+};
+
+// Mixes preloaded samples into SDL_mixer's output through a post-mix hook.
+// Game code only talks to the audio callback through the command queue.
+class AudioMixer {
+public:
+	bool Open(const char *driver = NULL, int frequency = 44100, int bufferFrames = 512);
+	void Close();
+
+	int LoadSample(const char *filePath);
+	void Play(int sample, int priority, float volume = 1.0f);
+	void StopAll();
+
+	AudioStats GetStats() const;
+	void PrintStats() const;
+
+	bool open = false;
+
+private:
+	static void MixCallback(void *udata, Uint8 *stream, int length);
+	void Mix(Sint16 *output, int frames);
+	void Start(const AudioCommand &command, Uint64 now);
+
+	struct Sample {
+		std::string name;
+		Mix_Chunk *chunk;
+		const Sint16 *data;
+		int frames;
+	};
+
+	std::vector<Sample> samples;
+	AudioCommandQueue queue;
+	AudioVoice voices[MAX_VOICES];
+	int accumulator[AUDIO_MAX_BUFFER_FRAMES * 2];
+
+	int frequency = 0;
+	int bufferFrames = 0;
+	Uint64 counterFrequency = 1;
+
+	std::atomic<Uint64> callbacks{ 0 };
+	std::atomic<Uint64> mixedFrames{ 0 };
+	std::atomic<Uint64> mixTicks{ 0 };
+	std::atomic<Uint64> played{ 0 };
+	std::atomic<Uint64> stolen{ 0 };
+	std::atomic<Uint64> dropped{ 0 };
+	std::atomic<Uint64> latencyTicks{ 0 };
+	std::atomic<Uint64> maxLatencyTicks{ 0 };
+};
@@ -0,0 +1,99 @@
+
+#include "Benchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+static double Percentile(const std::vector<double> &sorted, double fraction) {
+	double rank = fraction * (sorted.size() - 1);
+	size_t lower = (size_t) rank;
+	size_t upper = std::min(lower + 1, sorted.size() - 1);
+	return sorted[lower] + (sorted[upper] - sorted[lower]) * (rank - lower);
+}
+
+double Benchmark::Sample(const std::function<void()> &setup, const std::function<void()> &function, int batch) {
+	setup();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int i = 0; i < batch; i++) {
+		function();
+	}
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Benchmark::Run(const std::string &name, const std::function<void()> &function) {
+	Run(name, []() {}, function);
+}
+
+void Benchmark::Run(const std::string &name, const std::function<void()> &setup, const std::function<void()> &function) {
+	// Grow the batch until one sample is long enough for the clock to resolve it
+	int batch = 1;
+	while (batch < maxBatch && Sample(setup, function, batch) < minSampleSeconds) {
+		batch = std::min(batch * 2, maxBatch);
+	}
+	for (int i = 0; i < warmup; i++) {
+		Sample(setup, function, batch);
+	}
+
+	BenchmarkResult result;
+	result.name = name;
+	result.batch = batch;
+	for (int i = 0; i < repetitions; i++) {
+		result.samples.push_back(Sample(setup, function, batch) * 1e9 / batch);
+	}
+
+	std::vector<double> sorted = result.samples;
+	std::sort(sorted.begin(), sorted.end());
+	double sum = 0.0;
+	for (size_t i = 0; i < sorted.size(); i++) {
+		sum += sorted[i];
+	}
+	result.mean = sum / sorted.size();
+	double variance = 0.0;
+	for (size_t i = 0; i < sorted.size(); i++) {
+		variance += (sorted[i] - result.mean) * (sorted[i] - result.mean);
+	}
+	result.stddev = sorted.size() > 1 ? sqrt(variance / (sorted.size() - 1)) : 0.0;
+	result.min = sorted.front();
+	result.p50 = Percentile(sorted, 0.50);
+	result.p90 = Percentile(sorted, 0.90);
+	result.p99 = Percentile(sorted, 0.99);
+	result.max = sorted.back();
+	results.push_back(result);
+
+	std::cout << std::left << std::setw(40) << name << std::right << std::fixed << std::setprecision(1)
+		<< " p50 " << std::setw(12) << result.p50 << " ns"
+		<< "  p99 " << std::setw(12) << result.p99 << " ns"
+		<< "  +/- " << std::setw(5) << (result.mean > 0.0 ? 100.0 * result.stddev / result.mean : 0.0) << "%" << std::endl;
+}
+
+static std::string EscapeJSON(const std::string &text) {
+	std::string escaped;
+	for (size_t i = 0; i < text.size(); i++) {
+		if (text[i] == '"' || text[i] == '\\') {
+			escaped += '\\';
+		}
+		escaped += text[i];
+	}
+	return escaped;
+}
+
+bool Benchmark::WriteJSON(const char *filePath) const {
+	std::ofstream outfile(filePath);
+	if (outfile.fail()) {
+		std::cout << "Unable to write benchmark results to " << filePath << std::endl;
+		return false;
+	}
+	outfile << std::setprecision(6) << "{\n  \"unit\": \"ns\",\n  \"warmup\": " << warmup << ",\n  \"repetitions\": " << repetitions << ",\n  \"benchmarks\": [";
+	for (size_t i = 0; i < results.size(); i++) {
+		const BenchmarkResult &result = results[i];
+		outfile << (i == 0 ? "\n" : ",\n") << "    { \"name\": \"" << EscapeJSON(result.name) << "\", \"batch\": " << result.batch
+			<< ", \"mean\": " << result.mean << ", \"stddev\": " << result.stddev << ", \"min\": " << result.min
+			<< ", \"p50\": " << result.p50 << ", \"p90\": " << result.p90 << ", \"p99\": " << result.p99
+			<< ", \"max\": " << result.max << " }";
+	}
+	outfile << "\n  ]\n}\n";
+	return true;
+}
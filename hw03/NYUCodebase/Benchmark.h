@@ -0,0 +1,56 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+
+struct BenchmarkResult {
+	std::string name;
+	int batch;
+	std::vector<double> samples;
+
+	double mean;
+	double stddev;
+	double min;
+	double p50;
+	double p90;
+	double p99;
+	double max;
+};
+
+// Keeps the optimizer from discarding a value whose only purpose is to be measured.
+template <typename T>
+inline void DoNotOptimize(const T &value) {
+#if defined(_MSC_VER)
+	static volatile const void *sink;
+	sink = &value;
+	_ReadWriteBarrier();
+#else
+	asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+// Times a function with warmup runs and repeated samples. Each sample runs the
+// function enough times to last at least minSampleSeconds, or maxBatch times;
+// results are per call. The optional setup runs untimed before every sample, so
+// work that changes state can start each sample from the same place.
+class Benchmark {
+public:
+	void Run(const std::string &name, const std::function<void()> &function);
+	void Run(const std::string &name, const std::function<void()> &setup, const std::function<void()> &function);
+	bool WriteJSON(const char *filePath) const;
+
+	int warmup = 5;
+	int repetitions = 30;
+	double minSampleSeconds = 0.002;
+	int maxBatch = 1 << 24;
+
+	std::vector<BenchmarkResult> results;
+
+private:
+	double Sample(const std::function<void()> &setup, const std::function<void()> &function, int batch);
+};
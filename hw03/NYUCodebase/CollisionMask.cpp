@@ -0,0 +1,187 @@
+
+#include "CollisionMask.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#if defined(__AVX2__)
+	#define COLLISION_MASK_AVX2
+	#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define COLLISION_MASK_SSE2
+	#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#define COLLISION_MASK_NEON
+	#include <arm_neon.h>
+#endif
+
+// A cell is solid when any pixel it covers is, so shrinking a sprite never
+// opens gaps in it. pixels is the whole RGBA8 image, top row first.
+bool CollisionMask::Build(const unsigned char *pixels, int imageWidth, int x, int y, int width, int height, float worldWidth, float worldHeight) {
+	rows.clear();
+	columns = (int) ceilf(worldWidth / MASK_CELL_SIZE);
+	int rowCount = (int) ceilf(worldHeight / MASK_CELL_SIZE);
+	if (pixels == NULL || width <= 0 || height <= 0 || columns <= 0 || rowCount <= 0) {
+		columns = 0;
+		return false;
+	}
+	if (columns > MASK_MAX_COLUMNS) {
+		std::cout << "Collision mask needs " << columns << " columns, at most " << MASK_MAX_COLUMNS << " fit" << std::endl;
+		columns = 0;
+		return false;
+	}
+
+	rows.assign(rowCount, 0);
+	for (int r = 0; r < rowCount; r++) {
+		int top = y + height - (r + 1) * height / rowCount;
+		int bottom = std::max(y + height - r * height / rowCount, top + 1);
+		for (int c = 0; c < columns; c++) {
+			int left = x + c * width / columns;
+			int right = std::max(x + (c + 1) * width / columns, left + 1);
+			bool solid = false;
+			for (int py = top; py < bottom && !solid; py++) {
+				const unsigned char *row = pixels + ((size_t) py * imageWidth + left) * 4;
+				for (int px = 0; px < right - left; px++) {
+					if (row[px * 4 + 3] >= MASK_ALPHA_THRESHOLD) {
+						solid = true;
+						break;
+					}
+				}
+			}
+			if (solid) {
+				rows[r] |= (MaskRow) 1 << c;
+			}
+		}
+	}
+	return true;
+}
+
+// Snaps b onto a's grid and finds the rows the two share. shift is how many
+// columns right of a's left edge b starts.
+static bool AlignRows(const CollisionMask &a, float ax, float ay, const CollisionMask &b, float bx, float by, const MaskRow *&rowsA, const MaskRow *&rowsB, int &count, int &shift) {
+	if (a.Empty() || b.Empty()) {
+		return false;
+	}
+	int rowCountA = (int) a.rows.size();
+	int rowCountB = (int) b.rows.size();
+	float aLeft = ax - a.columns * MASK_CELL_SIZE * 0.5f;
+	float aBottom = ay - rowCountA * MASK_CELL_SIZE * 0.5f;
+	float bLeft = bx - b.columns * MASK_CELL_SIZE * 0.5f;
+	float bBottom = by - rowCountB * MASK_CELL_SIZE * 0.5f;
+	shift = (int) lroundf((bLeft - aLeft) / MASK_CELL_SIZE);
+	int offset = (int) lroundf((bBottom - aBottom) / MASK_CELL_SIZE);
+	if (shift >= MASK_MAX_COLUMNS || shift <= -MASK_MAX_COLUMNS) {
+		return false;
+	}
+	int first = std::max(0, offset);
+	int last = std::min(rowCountA, offset + rowCountB);
+	if (first >= last) {
+		return false;
+	}
+	rowsA = a.rows.data() + first;
+	rowsB = b.rows.data() + first - offset;
+	count = last - first;
+	return true;
+}
+
+static bool RowsOverlapTail(const MaskRow *a, const MaskRow *b, int count, int shift) {
+	for (int i = 0; i < count; i++) {
+		MaskRow row = shift >= 0 ? b[i] << shift : b[i] >> -shift;
+		if (a[i] & row) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool MasksOverlapScalar(const CollisionMask &a, float ax, float ay, const CollisionMask &b, float bx, float by) {
+	const MaskRow *rowsA, *rowsB;
+	int count, shift;
+	if (!AlignRows(a, ax, ay, b, bx, by, rowsA, rowsB, count, shift)) {
+		return false;
+	}
+	return RowsOverlapTail(rowsA, rowsB, count, shift);
+}
+
+// Every row moves by the same shift, so whole vectors of rows shift together.
+
+#if defined(COLLISION_MASK_AVX2)
+
+static int RowsOverlapSimd(const MaskRow *a, const MaskRow *b, int count, int shift, bool &hit) {
+	__m128i left = _mm_cvtsi32_si128(shift > 0 ? shift : 0);
+	__m128i right = _mm_cvtsi32_si128(shift < 0 ? -shift : 0);
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m256i rowsB = _mm256_loadu_si256((const __m256i *) (b + i));
+		rowsB = _mm256_srl_epi64(_mm256_sll_epi64(rowsB, left), right);
+		__m256i both = _mm256_and_si256(_mm256_loadu_si256((const __m256i *) (a + i)), rowsB);
+		if (!_mm256_testz_si256(both, both)) {
+			hit = true;
+			return i;
+		}
+	}
+	return i;
+}
+
+const char *CollisionMaskPath() { return "avx2"; }
+
+#elif defined(COLLISION_MASK_SSE2)
+
+static int RowsOverlapSimd(const MaskRow *a, const MaskRow *b, int count, int shift, bool &hit) {
+	const __m128i zero = _mm_setzero_si128();
+	__m128i left = _mm_cvtsi32_si128(shift > 0 ? shift : 0);
+	__m128i right = _mm_cvtsi32_si128(shift < 0 ? -shift : 0);
+	int i = 0;
+	for (; i + 2 <= count; i += 2) {
+		__m128i rowsB = _mm_loadu_si128((const __m128i *) (b + i));
+		rowsB = _mm_srl_epi64(_mm_sll_epi64(rowsB, left), right);
+		__m128i both = _mm_and_si128(_mm_loadu_si128((const __m128i *) (a + i)), rowsB);
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(both, zero)) != 0xFFFF) {
+			hit = true;
+			return i;
+		}
+	}
+	return i;
+}
+
+const char *CollisionMaskPath() { return "sse2"; }
+
+#elif defined(COLLISION_MASK_NEON)
+
+// A negative shift count makes vshlq shift right.
+static int RowsOverlapSimd(const MaskRow *a, const MaskRow *b, int count, int shift, bool &hit) {
+	int64x2_t shifts = vdupq_n_s64(shift);
+	int i = 0;
+	for (; i + 2 <= count; i += 2) {
+		uint64x2_t rowsB = vshlq_u64(vld1q_u64((const uint64_t *) (b + i)), shifts);
+		uint64x2_t both = vandq_u64(vld1q_u64((const uint64_t *) (a + i)), rowsB);
+		if (vgetq_lane_u64(both, 0) | vgetq_lane_u64(both, 1)) {
+			hit = true;
+			return i;
+		}
+	}
+	return i;
+}
+
+const char *CollisionMaskPath() { return "neon"; }
+
+#else
+
+static int RowsOverlapSimd(const MaskRow *a, const MaskRow *b, int count, int shift, bool &hit) {
+	return 0;
+}
+
+const char *CollisionMaskPath() { return "scalar"; }
+
+#endif
+
+bool MasksOverlap(const CollisionMask &a, float ax, float ay, const CollisionMask &b, float bx, float by) {
+	const MaskRow *rowsA, *rowsB;
+	int count, shift;
+	if (!AlignRows(a, ax, ay, b, bx, by, rowsA, rowsB, count, shift)) {
+		return false;
+	}
+	bool hit = false;
+	int done = RowsOverlapSimd(rowsA, rowsB, count, shift, hit);
+	return hit || RowsOverlapTail(rowsA + done, rowsB + done, count - done, shift);
+}
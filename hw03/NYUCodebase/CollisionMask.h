@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+
+#define MASK_CELL_SIZE 0.005f
+#define MASK_MAX_COLUMNS 64
+#define MASK_ALPHA_THRESHOLD 128
+
+typedef unsigned long long MaskRow;
+
+// Which parts of a sprite are solid, sampled from its alpha channel once at a
+// fixed world resolution so any two masks line up cell for cell. Each row is
+// one 64 bit word with bit 0 on the left, and rows go from the bottom up.
+// A mask is laid out centred on the sprite at its unscaled, unrotated size.
+struct CollisionMask {
+	bool Build(const unsigned char *pixels, int imageWidth, int x, int y, int width, int height, float worldWidth, float worldHeight);
+	bool Empty() const { return rows.empty(); }
+
+	int columns = 0;
+	std::vector<MaskRow> rows;
+};
+
+// True when the solid cells of two masks centred at (ax, ay) and (bx, by) overlap.
+bool MasksOverlap(const CollisionMask &a, float ax, float ay, const CollisionMask &b, float bx, float by);
+bool MasksOverlapScalar(const CollisionMask &a, float ax, float ay, const CollisionMask &b, float bx, float by);
+
+// Name of the SIMD path MasksOverlap was compiled with ("avx2", "sse2", "neon" or "scalar").
+const char *CollisionMaskPath();
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+
+#define ENTITY_INDEX_BITS 20
+#define ENTITY_INDEX_MASK ((1u << ENTITY_INDEX_BITS) - 1)
+#define ENTITY_GENERATION_MASK ((1u << (32 - ENTITY_INDEX_BITS)) - 1)
+#define INVALID_ENTITY 0xffffffffu
+
+typedef unsigned int EntityHandle;
+
+// Keeps live entities packed in one array so iteration only touches what exists.
+// A handle is a slot in the low 20 bits and that slot's generation in the high 12;
+// removing an entity bumps the generation so stale handles stop resolving.
+// Destroy() only marks an entity, Flush() removes the marked ones at the end of the tick.
+template <typename T>
+class EntityRegistry {
+public:
+	EntityHandle Create(const T &value);
+	void Destroy(EntityHandle handle);
+	void Flush();
+	void Clear();
+	void Reserve(size_t count);
+
+	bool IsAlive(EntityHandle handle) const;
+	T *Get(EntityHandle handle);
+
+	size_t Size() const { return dense.size(); }
+	T &operator[](size_t index) { return dense[index]; }
+	const T &operator[](size_t index) const { return dense[index]; }
+	EntityHandle HandleAt(size_t index) const { return handles[index]; }
+	bool IsDestroyed(size_t index) const { return destroyed[index] != 0; }
+
+private:
+	std::vector<T> dense;
+	std::vector<EntityHandle> handles;
+	std::vector<unsigned char> destroyed;
+	std::vector<unsigned int> slots;
+	std::vector<unsigned int> generations;
+	std::vector<unsigned int> freeSlots;
+	std::vector<EntityHandle> pending;
+};
+
+template <typename T>
+EntityHandle EntityRegistry<T>::Create(const T &value) {
+	unsigned int slot;
+	if (!freeSlots.empty()) {
+		slot = freeSlots.back();
+		freeSlots.pop_back();
+	} else {
+		slot = (unsigned int) slots.size();
+		if (slot >= ENTITY_INDEX_MASK) {
+			std::cout << "Entity registry is full" << std::endl;
+			return INVALID_ENTITY;
+		}
+		slots.push_back(0);
+		generations.push_back(0);
+	}
+
+	EntityHandle handle = (generations[slot] << ENTITY_INDEX_BITS) | slot;
+	slots[slot] = (unsigned int) dense.size();
+	dense.push_back(value);
+	handles.push_back(handle);
+	destroyed.push_back(0);
+	return handle;
+}
+
+template <typename T>
+void EntityRegistry<T>::Destroy(EntityHandle handle) {
+	if (!IsAlive(handle)) {
+		return;
+	}
+	destroyed[slots[handle & ENTITY_INDEX_MASK]] = 1;
+	pending.push_back(handle);
+}
+
+template <typename T>
+void EntityRegistry<T>::Flush() {
+	for (size_t i = 0; i < pending.size(); i++) {
+		unsigned int slot = pending[i] & ENTITY_INDEX_MASK;
+		unsigned int index = slots[slot];
+		size_t last = dense.size() - 1;
+
+		// Move the last entity into the hole so the array stays packed
+		if (index != last) {
+			dense[index] = dense[last];
+			handles[index] = handles[last];
+			destroyed[index] = destroyed[last];
+			slots[handles[index] & ENTITY_INDEX_MASK] = index;
+		}
+		dense.pop_back();
+		handles.pop_back();
+		destroyed.pop_back();
+
+		generations[slot] = (generations[slot] + 1) & ENTITY_GENERATION_MASK;
+		freeSlots.push_back(slot);
+	}
+	pending.clear();
+}
+
+template <typename T>
+void EntityRegistry<T>::Clear() {
+	for (size_t i = 0; i < handles.size(); i++) {
+		unsigned int slot = handles[i] & ENTITY_INDEX_MASK;
+		generations[slot] = (generations[slot] + 1) & ENTITY_GENERATION_MASK;
+		freeSlots.push_back(slot);
+	}
+	dense.clear();
+	handles.clear();
+	destroyed.clear();
+	pending.clear();
+}
+
+template <typename T>
+void EntityRegistry<T>::Reserve(size_t count) {
+	dense.reserve(count);
+	handles.reserve(count);
+	destroyed.reserve(count);
+	slots.reserve(count);
+	generations.reserve(count);
+	freeSlots.reserve(count);
+	pending.reserve(count);
+}
+
+template <typename T>
+bool EntityRegistry<T>::IsAlive(EntityHandle handle) const {
+	unsigned int slot = handle & ENTITY_INDEX_MASK;
+	if (handle == INVALID_ENTITY || slot >= slots.size() || generations[slot] != handle >> ENTITY_INDEX_BITS) {
+		return false;
+	}
+	// After 4096 reuses a freed slot's generation comes round to a stale handle's again,
+	// and the slot's old dense index may be past the end or now hold another entity
+	unsigned int index = slots[slot];
+	return index < handles.size() && handles[index] == handle && destroyed[index] == 0;
+}
+
+template <typename T>
+T *EntityRegistry<T>::Get(EntityHandle handle) {
+	return IsAlive(handle) ? &dense[slots[handle & ENTITY_INDEX_MASK]] : NULL;
+}
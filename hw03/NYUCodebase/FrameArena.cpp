@@ -0,0 +1,46 @@
+
+#include "FrameArena.h"
+#include <cstdlib>
+#include <iostream>
+
+FrameArena::FrameArena(size_t capacity) : capacity(capacity) {
+	buffers[0] = (char *) malloc(capacity);
+	buffers[1] = (char *) malloc(capacity);
+}
+
+FrameArena::~FrameArena() {
+	for (int i = 0; i < 2; i++) {
+		for (size_t j = 0; j < spilled[i].size(); j++) {
+			free(spilled[i][j]);
+		}
+		free(buffers[i]);
+	}
+}
+
+void *FrameArena::Allocate(size_t bytes, size_t alignment) {
+	size_t start = (offset + alignment - 1) & ~(alignment - 1);
+	if (start + bytes > capacity) {
+		overflows++;
+		void *block = malloc(bytes);
+		spilled[current].push_back(block);
+		return block;
+	}
+	offset = start + bytes;
+	if (offset > highWaterMark) {
+		highWaterMark = offset;
+	}
+	return buffers[current] + start;
+}
+
+void FrameArena::BeginFrame() {
+	current = 1 - current;
+	offset = 0;
+	for (size_t i = 0; i < spilled[current].size(); i++) {
+		free(spilled[current][i]);
+	}
+	spilled[current].clear();
+}
+
+void FrameArena::PrintStats(const char *name) const {
+	std::cout << name << ": high water " << highWaterMark / 1024.0 << " KB of " << capacity / 1024 << " KB, overflows " << overflows << std::endl;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#define FRAME_ARENA_SIZE (1024 * 1024)
+
+// Bump allocator for data that only lives for a frame. There are two buffers:
+// BeginFrame() resets the older one, so an allocation stays valid through the
+// following frame as well. Requests that do not fit fall back to the heap and
+// are counted as overflows, which means the arena should be made larger.
+class FrameArena {
+public:
+	FrameArena(size_t capacity = FRAME_ARENA_SIZE);
+	~FrameArena();
+
+	void *Allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+	template <typename T>
+	T *AllocateArray(size_t count) { return (T *) Allocate(count * sizeof(T), alignof(T)); }
+	void BeginFrame();
+
+	size_t Used() const { return offset; }
+	size_t HighWaterMark() const { return highWaterMark; }
+	size_t Capacity() const { return capacity; }
+	unsigned int Overflows() const { return overflows; }
+	void PrintStats(const char *name = "frame arena") const;
+
+private:
+	FrameArena(const FrameArena &);
+	FrameArena &operator=(const FrameArena &);
+
+	char *buffers[2];
+	std::vector<void *> spilled[2];
+	int current = 0;
+	size_t capacity;
+	size_t offset = 0;
+	size_t highWaterMark = 0;
+	unsigned int overflows = 0;
+};
+
+template <typename T>
+class ArenaAllocator {
+public:
+	typedef T value_type;
+
+	ArenaAllocator(FrameArena &arena) : arena(&arena) {}
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+
+	T *allocate(size_t count) { return arena->AllocateArray<T>(count); }
+	void deallocate(T *, size_t) {}
+
+	FrameArena *arena;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) { return a.arena == b.arena; }
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) { return a.arena != b.arena; }
+
+template <typename T>
+using FrameVector = std::vector<T, ArenaAllocator<T> >;
@@ -0,0 +1,110 @@
+
+#include "FramePacer.h"
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+void FramePacer::Setup(int targetRate, bool vsync) {
+	swapInterval = 0;
+	if (vsync) {
+		// Adaptive vsync tears a late frame instead of waiting a whole extra refresh
+		if (SDL_GL_SetSwapInterval(-1) == 0) {
+			swapInterval = -1;
+		} else if (SDL_GL_SetSwapInterval(1) == 0) {
+			swapInterval = 1;
+		}
+	}
+	if (swapInterval == 0) {
+		SDL_GL_SetSwapInterval(0);
+	}
+	SetRate(targetRate);
+}
+
+void FramePacer::SetRate(int targetRate) {
+	int refreshRate = DEFAULT_FRAME_RATE;
+	if (targetRate <= 0 || swapInterval != 0) {
+		SDL_DisplayMode mode;
+		if (SDL_GetCurrentDisplayMode(0, &mode) == 0 && mode.refresh_rate > 0) {
+			refreshRate = mode.refresh_rate;
+		}
+	}
+	if (targetRate <= 0) {
+		targetRate = refreshRate;
+	}
+	vsyncPaced = swapInterval != 0 && targetRate >= refreshRate;
+	frequency = SDL_GetPerformanceFrequency();
+	period = frequency / targetRate;
+	lastFrame = SDL_GetPerformanceCounter();
+	deadline = lastFrame + period;
+}
+
+void FramePacer::Wait() {
+	Uint64 now = SDL_GetPerformanceCounter();
+	frames++;
+
+	// When vsync paces, the swap already waits for the display, so only hold back frames
+	// that come in at over twice the target rate, which means vsync is not blocking
+	if (vsyncPaced) {
+		if (now - lastFrame > period + period / 2) {
+			missed++;
+		}
+		deadline = lastFrame + period / 2;
+	}
+
+	if (now > deadline) {
+		double lateness = (double) (now - deadline) / frequency;
+		if (!vsyncPaced) {
+			missed++;
+			if (lateness > worstLateness) {
+				worstLateness = lateness;
+			}
+		}
+		// Start over from now rather than rushing through the frames that were missed
+		deadline = now - deadline >= period ? now : deadline;
+	} else {
+		SleepUntil(deadline);
+	}
+
+	lastFrame = SDL_GetPerformanceCounter();
+	deadline += period;
+}
+
+void FramePacer::SleepUntil(Uint64 target) {
+	Uint64 now = SDL_GetPerformanceCounter();
+	Uint64 spinTicks = (Uint64) (spinMargin * frequency);
+	while (target > now && target - now > spinTicks) {
+		double remaining = (double) (target - now - spinTicks) / frequency;
+		std::this_thread::sleep_for(std::chrono::microseconds((long long) (remaining * 1e6)));
+		Uint64 woke = SDL_GetPerformanceCounter();
+		sleptSeconds += (double) (woke - now) / frequency;
+
+		// Learn how far the OS oversleeps so the spin starts early enough next time
+		double oversleep = ((double) (woke - now) / frequency - remaining) * PACER_MARGIN_HEADROOM;
+		if (oversleep > spinMargin) {
+			spinMargin = oversleep;
+		} else {
+			spinMargin += (oversleep - spinMargin) * PACER_MARGIN_DECAY;
+		}
+		double limit = (double) period / frequency / 2;
+		spinMargin = spinMargin < 0.0 ? 0.0 : (spinMargin < limit ? spinMargin : limit);
+		spinTicks = (Uint64) (spinMargin * frequency);
+		now = woke;
+	}
+
+	Uint64 spinStart = now;
+	while (now < target) {
+		now = SDL_GetPerformanceCounter();
+	}
+	spunSeconds += (double) (now - spinStart) / frequency;
+}
+
+void FramePacer::PrintStats() const {
+	std::cout << "frame pacing: " << (double) frequency / period << " fps target, swap interval " << swapInterval
+		<< (vsyncPaced ? ", paced by vsync" : ", paced by deadline") << std::endl;
+	std::cout << "paced frames: " << frames << ", missed deadlines: " << missed << ", worst lateness "
+		<< worstLateness * 1000.0 << " ms" << std::endl;
+	if (frames > 0) {
+		std::cout << "waiting per frame: " << sleptSeconds * 1000.0 / frames << " ms asleep, "
+			<< spunSeconds * 1000.0 / frames << " ms spinning, spin margin " << spinMargin * 1000.0 << " ms" << std::endl;
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <SDL.h>
+
+#define DEFAULT_FRAME_RATE 60
+#define PACER_SPIN_MARGIN 0.002
+#define PACER_MARGIN_DECAY 0.05
+#define PACER_MARGIN_HEADROOM 1.5
+
+// Holds the main loop to a target frame rate. Sleeps through most of the wait and
+// spins for the last stretch. The margin jumps up to cover any oversleep at once and
+// then eases back down towards the oversleep usually seen, so one slow wake-up does
+// not keep the pacer spinning for the rest of the run.
+// Vsync is requested too (adaptive when the driver has it). When the target is the
+// display's refresh rate or faster the pacer then only catches frames that vsync
+// fails to block, e.g. on a minimized window, and counts a frame that took over
+// one and a half periods as a missed deadline. A target below the refresh rate is
+// paced to its own period as if vsync were off.
+class FramePacer {
+public:
+	void Setup(int targetRate, bool vsync);
+	void SetRate(int targetRate);
+	void Wait();
+
+	void PrintStats() const;
+
+	int swapInterval = 0;
+	// True when the swap alone holds frames to the target rate
+	bool vsyncPaced = false;
+
+private:
+	void SleepUntil(Uint64 target);
+
+	Uint64 frequency = 1;
+	Uint64 period = 0;
+	Uint64 deadline = 0;
+	Uint64 lastFrame = 0;
+	double spinMargin = PACER_SPIN_MARGIN;
+
+	unsigned int frames = 0;
+	unsigned int missed = 0;
+	double sleptSeconds = 0.0;
+	double spunSeconds = 0.0;
+	double worstLateness = 0.0;
+};
@@ -0,0 +1,289 @@
+
+#include "FrameTelemetry.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static int BucketIndex(unsigned int micros) {
+	if (micros < HISTOGRAM_SUB_BUCKETS) {
+		return (int) micros;
+	}
+	int msb = 31;
+	while (!(micros & (1u << msb))) {
+		msb--;
+	}
+	int shift = msb - 5;
+	return HISTOGRAM_SUB_BUCKETS + shift * HISTOGRAM_SUB_BUCKETS + (int) (micros >> shift) - HISTOGRAM_SUB_BUCKETS;
+}
+
+static unsigned int BucketHighestValue(int index) {
+	if (index < HISTOGRAM_SUB_BUCKETS) {
+		return (unsigned int) index;
+	}
+	int shift = (index - HISTOGRAM_SUB_BUCKETS) / HISTOGRAM_SUB_BUCKETS;
+	unsigned int sub = (unsigned int) ((index - HISTOGRAM_SUB_BUCKETS) % HISTOGRAM_SUB_BUCKETS + HISTOGRAM_SUB_BUCKETS);
+	return (sub << shift) + ((1u << shift) - 1);
+}
+
+LatencyHistogram::LatencyHistogram() {
+	Clear();
+}
+
+void LatencyHistogram::Record(unsigned int micros) {
+	buckets[BucketIndex(micros)]++;
+	count++;
+	if (micros > max) {
+		max = micros;
+	}
+}
+
+void LatencyHistogram::Clear() {
+	memset(buckets, 0, sizeof(buckets));
+	count = 0;
+	max = 0;
+}
+
+unsigned int LatencyHistogram::Percentile(double fraction) const {
+	if (count == 0) {
+		return 0;
+	}
+	unsigned long long target = (unsigned long long) (fraction * count + 0.5);
+	if (target < 1) {
+		target = 1;
+	}
+	unsigned long long seen = 0;
+	for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+		seen += buckets[i];
+		if (seen >= target) {
+			unsigned int value = BucketHighestValue(i);
+			return value < max ? value : max;
+		}
+	}
+	return max;
+}
+
+const char *FramePhaseName(FramePhase phase) {
+	static const char *names[] = { "events", "update", "render", "swap", "frame" };
+	return names[phase];
+}
+
+long long FrameTelemetry::Now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void FrameTelemetry::BeginFrame() {
+	frameStart = Now();
+	phaseStart = frameStart;
+	currentPhase = -1;
+	memset(durations, 0, sizeof(durations));
+}
+
+void FrameTelemetry::Begin(FramePhase phase) {
+	long long now = Now();
+	if (currentPhase >= 0) {
+		durations[currentPhase] += now - phaseStart;
+	}
+	currentPhase = phase;
+	phaseStart = now;
+}
+
+// Called with the mutex held. sample counts the frames or ticks recorded for the phase so far.
+void FrameTelemetry::Record(FramePhase phase, unsigned int sample, long long nanoseconds) {
+	unsigned int micros = (unsigned int) (nanoseconds / 1000);
+	total[phase].Record(micros);
+	recent[phase][sample % TELEMETRY_WINDOW_FRAMES] = micros;
+}
+
+void FrameTelemetry::EndFrame() {
+	long long now = Now();
+	if (currentPhase >= 0) {
+		durations[currentPhase] += now - phaseStart;
+	}
+	currentPhase = -1;
+	durations[PHASE_FRAME] = now - frameStart;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for (int i = FIRST_FRAME_PHASE; i < PHASE_COUNT; i++) {
+		Record((FramePhase) i, frame, durations[i]);
+	}
+
+	if (durations[PHASE_FRAME] / 1e6 > spikeThreshold) {
+		spikeCount++;
+		if (spikes.size() < MAX_SPIKES) {
+			FrameSpike spike;
+			spike.frame = frame;
+			spike.worstPhase = (FramePhase) FIRST_FRAME_PHASE;
+			for (int i = 0; i < PHASE_COUNT; i++) {
+				spike.phases[i] = durations[i] / 1e6;
+				if (i != PHASE_FRAME && durations[i] > durations[spike.worstPhase]) {
+					spike.worstPhase = (FramePhase) i;
+				}
+			}
+			spikes.push_back(spike);
+		}
+	}
+
+	frame++;
+	if (frame >= TELEMETRY_WINDOW_FRAMES && frame % TELEMETRY_WINDOW_STEP == 0) {
+		TelemetryWindow summary;
+		summary.firstFrame = frame - TELEMETRY_WINDOW_FRAMES;
+		summary.frames = TELEMETRY_WINDOW_FRAMES;
+		for (int i = 0; i < PHASE_COUNT; i++) {
+			summary.phases[i] = Rolling((FramePhase) i);
+		}
+		windows.push_back(summary);
+	}
+}
+
+void FrameTelemetry::AddTick(long long eventsNanoseconds, long long updateNanoseconds) {
+	std::lock_guard<std::mutex> lock(mutex);
+	Record(PHASE_EVENTS, ticks, eventsNanoseconds);
+	Record(PHASE_UPDATE, ticks, updateNanoseconds);
+	ticks++;
+}
+
+PhaseSummary FrameTelemetry::Summarize(const LatencyHistogram &histogram) {
+	PhaseSummary summary;
+	summary.p50 = histogram.Percentile(0.5) / 1000.0;
+	summary.p95 = histogram.Percentile(0.95) / 1000.0;
+	summary.p99 = histogram.Percentile(0.99) / 1000.0;
+	summary.max = histogram.Max() / 1000.0;
+	return summary;
+}
+
+PhaseSummary FrameTelemetry::Summary(FramePhase phase) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return Summarize(total[phase]);
+}
+
+unsigned int FrameTelemetry::Ticks() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return ticks;
+}
+
+PhaseSummary FrameTelemetry::RollingSummary(FramePhase phase) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return Rolling(phase);
+}
+
+// Exact percentiles over the last TELEMETRY_WINDOW_FRAMES frames or ticks, or fewer
+// early in the run. Called with the mutex held.
+PhaseSummary FrameTelemetry::Rolling(FramePhase phase) const {
+	PhaseSummary summary = {};
+	unsigned int samples = phase < FIRST_FRAME_PHASE ? ticks : frame;
+	unsigned int count = std::min(samples, (unsigned int) TELEMETRY_WINDOW_FRAMES);
+	if (count == 0) {
+		return summary;
+	}
+	unsigned int sorted[TELEMETRY_WINDOW_FRAMES];
+	std::copy(recent[phase], recent[phase] + count, sorted);
+	std::sort(sorted, sorted + count);
+	double fractions[] = { 0.5, 0.95, 0.99 };
+	double *values[] = { &summary.p50, &summary.p95, &summary.p99 };
+	for (int i = 0; i < 3; i++) {
+		unsigned int rank = std::max(1u, (unsigned int) (fractions[i] * count + 0.5));
+		*values[i] = sorted[rank - 1] / 1000.0;
+	}
+	summary.max = sorted[count - 1] / 1000.0;
+	return summary;
+}
+
+void FrameTelemetry::PrintSummary() const {
+	std::cout << "frames: " << frame << ", ticks: " << Ticks() << ", spikes over " << spikeThreshold << " ms: " << spikeCount << std::endl;
+	for (int i = 0; i < PHASE_COUNT; i++) {
+		PhaseSummary summary = Summary((FramePhase) i);
+		std::cout << FramePhaseName((FramePhase) i) << ": p50 " << summary.p50 << " ms, p95 " << summary.p95 << " ms, p99 "
+			<< summary.p99 << " ms, max " << summary.max << " ms" << std::endl;
+	}
+}
+
+bool FrameTelemetry::Export(const char *filePath) const {
+	size_t length = strlen(filePath);
+	if (length > 4 && strcmp(filePath + length - 4, ".csv") == 0) {
+		return WriteCSV(filePath);
+	}
+	return WriteJSON(filePath);
+}
+
+static void WriteSummary(std::ofstream &outfile, const PhaseSummary *phases) {
+	outfile << "{";
+	for (int i = 0; i < PHASE_COUNT; i++) {
+		outfile << (i > 0 ? ", " : "") << "\"" << FramePhaseName((FramePhase) i) << "\": {\"p50\": " << phases[i].p50
+			<< ", \"p95\": " << phases[i].p95 << ", \"p99\": " << phases[i].p99 << ", \"max\": " << phases[i].max << "}";
+	}
+	outfile << "}";
+}
+
+bool FrameTelemetry::WriteJSON(const char *filePath) const {
+	std::ofstream outfile(filePath);
+	if (outfile.fail()) {
+		std::cout << "Unable to write frame telemetry to " << filePath << std::endl;
+		return false;
+	}
+
+	PhaseSummary overall[PHASE_COUNT];
+	for (int i = 0; i < PHASE_COUNT; i++) {
+		overall[i] = Summary((FramePhase) i);
+	}
+	outfile << "{\n  \"frames\": " << frame << ",\n  \"ticks\": " << Ticks() << ",\n  \"windowFrames\": " << TELEMETRY_WINDOW_FRAMES << ",\n  \"windowStep\": " << TELEMETRY_WINDOW_STEP
+		<< ",\n  \"spikeThresholdMs\": " << spikeThreshold << ",\n  \"spikeCount\": " << spikeCount << ",\n  \"overall\": ";
+	WriteSummary(outfile, overall);
+
+	outfile << ",\n  \"windows\": [";
+	for (size_t i = 0; i < windows.size(); i++) {
+		outfile << (i > 0 ? "," : "") << "\n    {\"firstFrame\": " << windows[i].firstFrame << ", \"frames\": " << windows[i].frames << ", \"phases\": ";
+		WriteSummary(outfile, windows[i].phases);
+		outfile << "}";
+	}
+
+	outfile << "\n  ],\n  \"spikes\": [";
+	for (size_t i = 0; i < spikes.size(); i++) {
+		outfile << (i > 0 ? "," : "") << "\n    {\"frameIndex\": " << spikes[i].frame << ", \"phase\": \"" << FramePhaseName(spikes[i].worstPhase) << "\"";
+		for (int j = FIRST_FRAME_PHASE; j < PHASE_COUNT; j++) {
+			outfile << ", \"" << FramePhaseName((FramePhase) j) << "\": " << spikes[i].phases[j];
+		}
+		outfile << "}";
+	}
+	outfile << "\n  ]\n}\n";
+	return outfile.good();
+}
+
+bool FrameTelemetry::WriteCSV(const char *filePath) const {
+	std::ofstream outfile(filePath);
+	if (outfile.fail()) {
+		std::cout << "Unable to write frame telemetry to " << filePath << std::endl;
+		return false;
+	}
+
+	// Percentiles per rolling window, then the whole run as window "all". Events and
+	// update cover the last ticks at the end of each window rather than its frames.
+	outfile << "window,first_frame,frames,phase,p50_ms,p95_ms,p99_ms,max_ms\n";
+	for (size_t i = 0; i < windows.size(); i++) {
+		for (int j = 0; j < PHASE_COUNT; j++) {
+			const PhaseSummary &summary = windows[i].phases[j];
+			outfile << i << "," << windows[i].firstFrame << "," << windows[i].frames << "," << FramePhaseName((FramePhase) j) << ","
+				<< summary.p50 << "," << summary.p95 << "," << summary.p99 << "," << summary.max << "\n";
+		}
+	}
+	for (int j = 0; j < PHASE_COUNT; j++) {
+		PhaseSummary summary = Summary((FramePhase) j);
+		outfile << "all,0," << (j < FIRST_FRAME_PHASE ? Ticks() : frame) << "," << FramePhaseName((FramePhase) j) << ","
+			<< summary.p50 << "," << summary.p95 << "," << summary.p99 << "," << summary.max << "\n";
+	}
+
+	outfile << "\nspike_frame,worst_phase";
+	for (int j = FIRST_FRAME_PHASE; j < PHASE_COUNT; j++) {
+		outfile << "," << FramePhaseName((FramePhase) j) << "_ms";
+	}
+	outfile << "\n";
+	for (size_t i = 0; i < spikes.size(); i++) {
+		outfile << spikes[i].frame << "," << FramePhaseName(spikes[i].worstPhase);
+		for (int j = FIRST_FRAME_PHASE; j < PHASE_COUNT; j++) {
+			outfile << "," << spikes[i].phases[j];
+		}
+		outfile << "\n";
+	}
+	return outfile.good();
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define HISTOGRAM_SUB_BUCKETS 32
+#define HISTOGRAM_BUCKETS (HISTOGRAM_SUB_BUCKETS * 28)
+#define TELEMETRY_WINDOW_FRAMES 120
+#define TELEMETRY_WINDOW_STEP 30
+#define TELEMETRY_SPIKE_MS 25.0
+#define MAX_SPIKES 1024
+
+// Events and update are timed once per simulation tick, the rest once per rendered frame.
+enum FramePhase { PHASE_EVENTS, PHASE_UPDATE, PHASE_RENDER, PHASE_SWAP, PHASE_FRAME, PHASE_COUNT };
+#define FIRST_FRAME_PHASE PHASE_RENDER
+
+// Counts microsecond values in log-linear buckets: exact below 32us, then 32
+// buckets per power of two, so any percentile is within about 3% of the truth
+// no matter how long the run is.
+class LatencyHistogram {
+public:
+	LatencyHistogram();
+
+	void Record(unsigned int micros);
+	void Clear();
+	unsigned int Percentile(double fraction) const;
+	unsigned int Max() const { return max; }
+	unsigned long long Count() const { return count; }
+
+private:
+	unsigned long long buckets[HISTOGRAM_BUCKETS];
+	unsigned long long count;
+	unsigned int max;
+};
+
+struct PhaseSummary {
+	double p50;
+	double p95;
+	double p99;
+	double max;
+};
+
+struct TelemetryWindow {
+	unsigned int firstFrame;
+	unsigned int frames;
+	PhaseSummary phases[PHASE_COUNT];
+};
+
+struct FrameSpike {
+	unsigned int frame;
+	FramePhase worstPhase;
+	double phases[PHASE_COUNT];
+};
+
+// Times the render thread's frames phase by phase. Begin() starts a phase and
+// ends the one before it, EndFrame() closes the frame; PHASE_FRAME is the wall
+// time from BeginFrame() until the frame is presented. The simulation runs on
+// its own thread at its own rate, so AddTick() records each tick's events and
+// update time as samples of their own and may be called from that thread.
+// Keeps a histogram for the whole run and the last TELEMETRY_WINDOW_FRAMES
+// samples of every phase, summarized every TELEMETRY_WINDOW_STEP frames, and
+// lists frames slower than the spike threshold along with the phase that took
+// longest.
+class FrameTelemetry {
+public:
+	void BeginFrame();
+	void Begin(FramePhase phase);
+	void EndFrame();
+	void AddTick(long long eventsNanoseconds, long long updateNanoseconds);
+
+	PhaseSummary Summary(FramePhase phase) const;
+	PhaseSummary RollingSummary(FramePhase phase) const;
+	void PrintSummary() const;
+	bool Export(const char *filePath) const;
+
+	double spikeThreshold = TELEMETRY_SPIKE_MS;
+
+private:
+	static long long Now();
+	static PhaseSummary Summarize(const LatencyHistogram &histogram);
+	PhaseSummary Rolling(FramePhase phase) const;
+	unsigned int Ticks() const;
+	void Record(FramePhase phase, unsigned int sample, long long nanoseconds);
+	bool WriteJSON(const char *filePath) const;
+	bool WriteCSV(const char *filePath) const;
+
+	LatencyHistogram total[PHASE_COUNT];
+	unsigned int recent[PHASE_COUNT][TELEMETRY_WINDOW_FRAMES];
+	std::vector<TelemetryWindow> windows;
+	std::vector<FrameSpike> spikes;
+	unsigned int spikeCount = 0;
+
+	unsigned int frame = 0;
+	unsigned int ticks = 0;
+	// Guards what both threads touch: the histograms and recent samples
+	mutable std::mutex mutex;
+	int currentPhase = -1;
+	long long frameStart = 0;
+	long long phaseStart = 0;
+	long long durations[PHASE_COUNT];
+};
+
+const char *FramePhaseName(FramePhase phase);
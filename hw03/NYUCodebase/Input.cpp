@@ -0,0 +1,175 @@
+
+#include "Input.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+bool InputScript::Load(const char *filePath) {
+	std::ifstream infile(filePath);
+	if (infile.fail()) {
+		std::cout << "Unable to open input script " << filePath << std::endl;
+		return false;
+	}
+
+	std::string line;
+	while (std::getline(infile, line)) {
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+		std::istringstream words(line);
+		Entry entry;
+		if (!(words >> entry.tick)) {
+			continue;
+		}
+		std::string word;
+		while (words >> word) {
+			if (word == "left") {
+				entry.input.left = true;
+			} else if (word == "right") {
+				entry.input.right = true;
+			} else if (word == "shoot") {
+				entry.input.shoot = true;
+			} else if (word == "click") {
+				entry.input.click = true;
+			}
+		}
+		entries.push_back(entry);
+	}
+	scripted = true;
+	nextEntry = 0;
+	return true;
+}
+
+void InputScript::Seed(unsigned int seed) {
+	random.seed(seed);
+	scripted = false;
+}
+
+InputState InputScript::Next(int tick) {
+	if (scripted) {
+		while (nextEntry < entries.size() && entries[nextEntry].tick <= tick) {
+			current = entries[nextEntry].input;
+			nextEntry++;
+		}
+		return current;
+	}
+
+	// Use the raw engine output, the std distributions differ between standard libraries
+	if (random() % 16 == 0) {
+		unsigned int direction = random() % 3;
+		current.left = direction == 1;
+		current.right = direction == 2;
+	}
+	current.shoot = random() % 4 == 0;
+	current.click = random() % 30 == 0;
+	return current;
+}
+
+enum InputBits { INPUT_LEFT = 1, INPUT_RIGHT = 2, INPUT_SHOOT = 4, INPUT_CLICK = 8 };
+
+void InputRecording::Begin(unsigned int seed) {
+	this->seed = seed;
+	inputs.clear();
+	checksums.clear();
+}
+
+void InputRecording::Record(const InputState &input) {
+	unsigned char bits = 0;
+	bits |= input.left ? INPUT_LEFT : 0;
+	bits |= input.right ? INPUT_RIGHT : 0;
+	bits |= input.shoot ? INPUT_SHOOT : 0;
+	bits |= input.click ? INPUT_CLICK : 0;
+	inputs.push_back(bits);
+}
+
+void InputRecording::AddChecksum(unsigned int checksum) {
+	checksums.push_back(checksum);
+}
+
+InputState InputRecording::Get(int tick) const {
+	InputState input;
+	if (tick < 0 || tick >= (int) inputs.size()) {
+		return input;
+	}
+	input.left = (inputs[tick] & INPUT_LEFT) != 0;
+	input.right = (inputs[tick] & INPUT_RIGHT) != 0;
+	input.shoot = (inputs[tick] & INPUT_SHOOT) != 0;
+	input.click = (inputs[tick] & INPUT_CLICK) != 0;
+	return input;
+}
+
+bool InputRecording::Verify(int ticks, unsigned int checksum) const {
+	size_t index = ticks / INPUT_CHECKSUM_INTERVAL - 1;
+	return ticks % INPUT_CHECKSUM_INTERVAL != 0 || index >= checksums.size() || checksums[index] == checksum;
+}
+
+// Written byte by byte so logs move between machines regardless of endianness
+static void WriteWord(std::ofstream &outfile, unsigned int value) {
+	unsigned char bytes[4] = { (unsigned char) value, (unsigned char) (value >> 8), (unsigned char) (value >> 16), (unsigned char) (value >> 24) };
+	outfile.write((const char *) bytes, 4);
+}
+
+static bool ReadWord(std::ifstream &infile, unsigned int &value) {
+	unsigned char bytes[4];
+	if (!infile.read((char *) bytes, 4)) {
+		return false;
+	}
+	value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((unsigned int) bytes[3] << 24);
+	return true;
+}
+
+bool InputRecording::Save(const char *filePath) const {
+	std::ofstream outfile(filePath, std::ios::binary);
+	if (outfile.fail()) {
+		std::cout << "Unable to write input recording " << filePath << std::endl;
+		return false;
+	}
+	WriteWord(outfile, INPUT_RECORDING_MAGIC);
+	WriteWord(outfile, seed);
+	WriteWord(outfile, (unsigned int) inputs.size());
+	WriteWord(outfile, (unsigned int) checksums.size());
+	outfile.write((const char *) inputs.data(), inputs.size());
+	for (size_t i = 0; i < checksums.size(); i++) {
+		WriteWord(outfile, checksums[i]);
+	}
+	return outfile.good();
+}
+
+bool InputRecording::Load(const char *filePath) {
+	std::ifstream infile(filePath, std::ios::binary);
+	if (infile.fail()) {
+		std::cout << "Unable to open input recording " << filePath << std::endl;
+		return false;
+	}
+
+	unsigned int magic, ticks, checksumCount;
+	if (!ReadWord(infile, magic) || magic != INPUT_RECORDING_MAGIC || !ReadWord(infile, seed) ||
+		!ReadWord(infile, ticks) || !ReadWord(infile, checksumCount)) {
+		std::cout << filePath << " is not an input recording" << std::endl;
+		return false;
+	}
+
+	// The counts come from the file, so check them against its length before allocating
+	std::streamoff start = infile.tellg();
+	infile.seekg(0, std::ios::end);
+	std::streamoff remaining = infile.tellg() - start;
+	infile.seekg(start);
+	if (!infile || remaining != (std::streamoff) ticks + (std::streamoff) checksumCount * 4) {
+		std::cout << "Input recording " << filePath << " is truncated or corrupt" << std::endl;
+		return false;
+	}
+
+	inputs.resize(ticks);
+	checksums.resize(checksumCount);
+	infile.read((char *) inputs.data(), ticks);
+	for (size_t i = 0; i < checksums.size() && infile; i++) {
+		ReadWord(infile, checksums[i]);
+	}
+	if (!infile) {
+		std::cout << "Input recording " << filePath << " is truncated" << std::endl;
+		inputs.clear();
+		checksums.clear();
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <random>
+#include <string>
+#include <vector>
+
+// Everything the game reads from the player in one tick.
+struct InputState {
+	bool left = false;
+	bool right = false;
+	bool shoot = false;
+	bool click = false;
+};
+
+// Input for runs without a keyboard, read from a script or generated from a seed.
+// A script line is "<tick> [left] [right] [shoot] [click]" and holds until the next line.
+class InputScript {
+public:
+	bool Load(const char *filePath);
+	void Seed(unsigned int seed);
+	InputState Next(int tick);
+
+private:
+	struct Entry {
+		int tick;
+		InputState input;
+	};
+
+	std::vector<Entry> entries;
+	size_t nextEntry = 0;
+	bool scripted = false;
+	InputState current;
+	std::mt19937 random;
+};
+
+#define INPUT_RECORDING_MAGIC 0x31524953
+#define INPUT_CHECKSUM_INTERVAL 60
+
+// A recorded session: the seed it ran with, one byte of input per fixed tick, and
+// the state checksum every INPUT_CHECKSUM_INTERVAL ticks so a replay can tell
+// where it stopped matching.
+class InputRecording {
+public:
+	void Begin(unsigned int seed);
+	void Record(const InputState &input);
+	void AddChecksum(unsigned int checksum);
+	bool Save(const char *filePath) const;
+	bool Load(const char *filePath);
+
+	int Ticks() const { return (int) inputs.size(); }
+	InputState Get(int tick) const;
+	bool Verify(int ticks, unsigned int checksum) const;
+
+	unsigned int seed = 0;
+
+private:
+	std::vector<unsigned char> inputs;
+	std::vector<unsigned int> checksums;
+};
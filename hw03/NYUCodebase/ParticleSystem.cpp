@@ -0,0 +1,213 @@
+
+#include "ParticleSystem.h"
+#include <cmath>
+
+#if defined(__AVX2__)
+	#define PARTICLE_UPDATE_AVX2
+	#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define PARTICLE_UPDATE_SSE2
+	#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#define PARTICLE_UPDATE_NEON
+	#include <arm_neon.h>
+#endif
+
+struct ParticleStep {
+	float elapsed;
+	float damping;
+	float pullX;
+	float pullY;
+};
+
+// Integration, drag and lifetime fade for particles [first, end).
+static void StepScalar(const ParticleStep &step, float *x, float *y, float *vx, float *vy, float *life, const float *inverseLifetime, float *alpha, int first, int end) {
+	for (int i = first; i < end; i++) {
+		vx[i] = vx[i] * step.damping + step.pullX;
+		vy[i] = vy[i] * step.damping + step.pullY;
+		x[i] += vx[i] * step.elapsed;
+		y[i] += vy[i] * step.elapsed;
+		life[i] -= step.elapsed;
+		alpha[i] = (life[i] > 0.0f ? life[i] : 0.0f) * inverseLifetime[i];
+	}
+}
+
+#if defined(PARTICLE_UPDATE_SSE2)
+
+static int StepSimd(const ParticleStep &step, float *x, float *y, float *vx, float *vy, float *life, const float *inverseLifetime, float *alpha, int count) {
+	const __m128 elapsed = _mm_set1_ps(step.elapsed);
+	const __m128 damping = _mm_set1_ps(step.damping);
+	const __m128 pullX = _mm_set1_ps(step.pullX);
+	const __m128 pullY = _mm_set1_ps(step.pullY);
+	const __m128 zero = _mm_setzero_ps();
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128 velocityX = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(vx + i), damping), pullX);
+		__m128 velocityY = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(vy + i), damping), pullY);
+		_mm_storeu_ps(vx + i, velocityX);
+		_mm_storeu_ps(vy + i, velocityY);
+		_mm_storeu_ps(x + i, _mm_add_ps(_mm_loadu_ps(x + i), _mm_mul_ps(velocityX, elapsed)));
+		_mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(velocityY, elapsed)));
+		__m128 remaining = _mm_sub_ps(_mm_loadu_ps(life + i), elapsed);
+		_mm_storeu_ps(life + i, remaining);
+		_mm_storeu_ps(alpha + i, _mm_mul_ps(_mm_max_ps(remaining, zero), _mm_loadu_ps(inverseLifetime + i)));
+	}
+	return i;
+}
+
+const char *ParticleUpdatePath() { return "sse2"; }
+
+#elif defined(PARTICLE_UPDATE_AVX2)
+
+static int StepSimd(const ParticleStep &step, float *x, float *y, float *vx, float *vy, float *life, const float *inverseLifetime, float *alpha, int count) {
+	const __m256 elapsed = _mm256_set1_ps(step.elapsed);
+	const __m256 damping = _mm256_set1_ps(step.damping);
+	const __m256 pullX = _mm256_set1_ps(step.pullX);
+	const __m256 pullY = _mm256_set1_ps(step.pullY);
+	const __m256 zero = _mm256_setzero_ps();
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256 velocityX = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(vx + i), damping), pullX);
+		__m256 velocityY = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(vy + i), damping), pullY);
+		_mm256_storeu_ps(vx + i, velocityX);
+		_mm256_storeu_ps(vy + i, velocityY);
+		_mm256_storeu_ps(x + i, _mm256_add_ps(_mm256_mul_ps(velocityX, elapsed), _mm256_loadu_ps(x + i)));
+		_mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_mul_ps(velocityY, elapsed), _mm256_loadu_ps(y + i)));
+		__m256 remaining = _mm256_sub_ps(_mm256_loadu_ps(life + i), elapsed);
+		_mm256_storeu_ps(life + i, remaining);
+		_mm256_storeu_ps(alpha + i, _mm256_mul_ps(_mm256_max_ps(remaining, zero), _mm256_loadu_ps(inverseLifetime + i)));
+	}
+	return i;
+}
+
+const char *ParticleUpdatePath() { return "avx2"; }
+
+#elif defined(PARTICLE_UPDATE_NEON)
+
+static int StepSimd(const ParticleStep &step, float *x, float *y, float *vx, float *vy, float *life, const float *inverseLifetime, float *alpha, int count) {
+	const float32x4_t damping = vdupq_n_f32(step.damping);
+	const float32x4_t pullX = vdupq_n_f32(step.pullX);
+	const float32x4_t pullY = vdupq_n_f32(step.pullY);
+	const float32x4_t elapsed = vdupq_n_f32(step.elapsed);
+	const float32x4_t zero = vdupq_n_f32(0.0f);
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		float32x4_t velocityX = vmlaq_f32(pullX, vld1q_f32(vx + i), damping);
+		float32x4_t velocityY = vmlaq_f32(pullY, vld1q_f32(vy + i), damping);
+		vst1q_f32(vx + i, velocityX);
+		vst1q_f32(vy + i, velocityY);
+		vst1q_f32(x + i, vmlaq_f32(vld1q_f32(x + i), velocityX, elapsed));
+		vst1q_f32(y + i, vmlaq_f32(vld1q_f32(y + i), velocityY, elapsed));
+		float32x4_t remaining = vsubq_f32(vld1q_f32(life + i), elapsed);
+		vst1q_f32(life + i, remaining);
+		vst1q_f32(alpha + i, vmulq_f32(vmaxq_f32(remaining, zero), vld1q_f32(inverseLifetime + i)));
+	}
+	return i;
+}
+
+const char *ParticleUpdatePath() { return "neon"; }
+
+#else
+
+static int StepSimd(const ParticleStep &step, float *x, float *y, float *vx, float *vy, float *life, const float *inverseLifetime, float *alpha, int count) {
+	return 0;
+}
+
+const char *ParticleUpdatePath() { return "scalar"; }
+
+#endif
+
+static ParticleStep MakeStep(float elapsed, float drag, float gravityX, float gravityY) {
+	ParticleStep step;
+	step.elapsed = elapsed;
+	step.damping = expf(-drag * elapsed);
+	step.pullX = gravityX * elapsed;
+	step.pullY = gravityY * elapsed;
+	return step;
+}
+
+void ParticleSystem::Setup(int capacity) {
+	x.assign(capacity, 0.0f);
+	y.assign(capacity, 0.0f);
+	vx.assign(capacity, 0.0f);
+	vy.assign(capacity, 0.0f);
+	life.assign(capacity, 0.0f);
+	inverseLifetime.assign(capacity, 0.0f);
+	alpha.assign(capacity, 0.0f);
+	count = 0;
+}
+
+// xorshift32, so effects never consume the game's rand() sequence.
+float ParticleSystem::Random() {
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return (seed >> 8) * (1.0f / 16777216.0f);
+}
+
+void ParticleSystem::Spawn(const ParticleEmitter &emitter) {
+	if (count >= Capacity()) {
+		return;
+	}
+	float angle = emitter.direction + (Random() - 0.5f) * emitter.spread;
+	float speed = emitter.minSpeed + Random() * (emitter.maxSpeed - emitter.minSpeed);
+	float lifetime = emitter.minLifetime + Random() * (emitter.maxLifetime - emitter.minLifetime);
+	x[count] = emitter.x;
+	y[count] = emitter.y;
+	vx[count] = cosf(angle) * speed;
+	vy[count] = sinf(angle) * speed;
+	life[count] = lifetime;
+	inverseLifetime[count] = 1.0f / lifetime;
+	alpha[count] = 1.0f;
+	count++;
+}
+
+void ParticleSystem::Burst(const ParticleEmitter &emitter, int particles) {
+	for (int i = 0; i < particles; i++) {
+		Spawn(emitter);
+	}
+}
+
+void ParticleSystem::Emit(ParticleEmitter &emitter, float elapsed) {
+	emitter.accumulator += emitter.rate * elapsed;
+	while (emitter.accumulator >= 1.0f) {
+		Spawn(emitter);
+		emitter.accumulator -= 1.0f;
+	}
+}
+
+// Walks backwards so the particle moved into a freed slot has already been checked.
+void ParticleSystem::RemoveDead() {
+	for (int i = count - 1; i >= 0; i--) {
+		if (life[i] > 0.0f) {
+			continue;
+		}
+		count--;
+		x[i] = x[count];
+		y[i] = y[count];
+		vx[i] = vx[count];
+		vy[i] = vy[count];
+		life[i] = life[count];
+		inverseLifetime[i] = inverseLifetime[count];
+		alpha[i] = alpha[count];
+	}
+}
+
+void ParticleSystem::Update(float elapsed) {
+	if (count == 0) {
+		return;
+	}
+	ParticleStep step = MakeStep(elapsed, drag, gravityX, gravityY);
+	int done = StepSimd(step, x.data(), y.data(), vx.data(), vy.data(), life.data(), inverseLifetime.data(), alpha.data(), count);
+	StepScalar(step, x.data(), y.data(), vx.data(), vy.data(), life.data(), inverseLifetime.data(), alpha.data(), done, count);
+	RemoveDead();
+}
+
+void ParticleSystem::UpdateScalar(float elapsed) {
+	if (count == 0) {
+		return;
+	}
+	ParticleStep step = MakeStep(elapsed, drag, gravityX, gravityY);
+	StepScalar(step, x.data(), y.data(), vx.data(), vy.data(), life.data(), inverseLifetime.data(), alpha.data(), 0, count);
+	RemoveDead();
+}
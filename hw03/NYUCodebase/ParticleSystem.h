@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+
+// Where and how particles are spawned. A burst emits a fixed count at once; a
+// continuous emitter emits rate particles per second, carrying fractions over
+// between updates.
+struct ParticleEmitter {
+	float x = 0.0f;
+	float y = 0.0f;
+	float direction = 0.0f;
+	float spread = 6.2831853f;
+	float minSpeed = 0.0f;
+	float maxSpeed = 1.0f;
+	float minLifetime = 0.5f;
+	float maxLifetime = 1.0f;
+	float rate = 0.0f;
+	float accumulator = 0.0f;
+};
+
+// Particles stored as one array per field so the update runs several particles
+// per SIMD instruction. Dead particles are swap-removed, which keeps the live
+// ones packed at the front in no particular order.
+class ParticleSystem {
+public:
+	void Setup(int capacity);
+	void Clear() { count = 0; }
+
+	void Burst(const ParticleEmitter &emitter, int particles);
+	void Emit(ParticleEmitter &emitter, float elapsed);
+	void Update(float elapsed);
+	void UpdateScalar(float elapsed);
+
+	int Size() const { return count; }
+	int Capacity() const { return (int) x.size(); }
+
+	float gravityX = 0.0f;
+	float gravityY = 0.0f;
+	float drag = 0.0f;
+
+	std::vector<float> x, y;
+	std::vector<float> vx, vy;
+	std::vector<float> life, inverseLifetime;
+	std::vector<float> alpha;
+
+private:
+	float Random();
+	void Spawn(const ParticleEmitter &emitter);
+	void RemoveDead();
+
+	int count = 0;
+	unsigned int seed = 0x9e3779b9u;
+};
+
+// Name of the SIMD path ParticleSystem::Update was compiled with ("avx2", "sse2", "neon" or "scalar").
+// The path is picked at compile time: avx2 only when the compiler targets it (-mavx2 or
+// /arch:AVX2), which the Visual Studio project does not, so that build runs sse2.
+const char *ParticleUpdatePath();
@@ -0,0 +1,190 @@
+
+#include "PixelConvert.h"
+#include <cmath>
+
+#if defined(__AVX2__)
+	#define PIXEL_CONVERT_AVX2
+	#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define PIXEL_CONVERT_SSE2
+	#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#define PIXEL_CONVERT_NEON
+	#include <arm_neon.h>
+#endif
+
+struct SrgbTable {
+	SrgbTable() {
+		for (int i = 0; i < 256; i++) {
+			float s = i / 255.0f;
+			float l = s <= 0.04045f ? s / 12.92f : powf((s + 0.055f) / 1.055f, 2.4f);
+			values[i] = (unsigned char) (l * 255.0f + 0.5f);
+		}
+	}
+	unsigned char values[256];
+};
+
+static const SrgbTable &GetSrgbTable() {
+	static SrgbTable table;
+	return table;
+}
+
+// sRGB decoding is a table lookup per channel, which no SIMD path here can beat.
+static void SrgbToLinear(unsigned char *pixels, int pixelCount) {
+	const unsigned char *table = GetSrgbTable().values;
+	for (int i = 0; i < pixelCount; i++) {
+		unsigned char *p = pixels + i * 4;
+		p[0] = table[p[0]];
+		p[1] = table[p[1]];
+		p[2] = table[p[2]];
+	}
+}
+
+// Exact round(c * a / 255) for 8 bit values.
+static inline unsigned char MultiplyAlpha(unsigned int c, unsigned int a) {
+	unsigned int t = c * a + 128;
+	return (unsigned char) ((t + (t >> 8)) >> 8);
+}
+
+static void ConvertTail(unsigned char *pixels, int pixelCount, unsigned int conversions) {
+	for (int i = 0; i < pixelCount; i++) {
+		unsigned char *p = pixels + i * 4;
+		if (conversions & PIXEL_PREMULTIPLY_ALPHA) {
+			p[0] = MultiplyAlpha(p[0], p[3]);
+			p[1] = MultiplyAlpha(p[1], p[3]);
+			p[2] = MultiplyAlpha(p[2], p[3]);
+		}
+		if (conversions & PIXEL_SWIZZLE_BGRA) {
+			unsigned char r = p[0];
+			p[0] = p[2];
+			p[2] = r;
+		}
+	}
+}
+
+void ConvertPixelsScalar(unsigned char *pixels, int pixelCount, unsigned int conversions) {
+	if (conversions & PIXEL_SRGB_TO_LINEAR) {
+		SrgbToLinear(pixels, pixelCount);
+	}
+	ConvertTail(pixels, pixelCount, conversions);
+}
+
+#if defined(PIXEL_CONVERT_SSE2)
+
+static inline __m128i PremultiplyHalf(__m128i px) {
+	__m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(px, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+	__m128i t = _mm_add_epi16(_mm_mullo_epi16(px, alpha), _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+static int ConvertSimd(unsigned char *pixels, int pixelCount, unsigned int conversions) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alphaMask = _mm_set1_epi32((int) 0xFF000000);
+	const __m128i agMask = _mm_set1_epi32((int) 0xFF00FF00);
+	const __m128i rbMask = _mm_set1_epi32(0x00FF00FF);
+	int i = 0;
+	for (; i + 4 <= pixelCount; i += 4) {
+		__m128i *p = (__m128i *) (pixels + i * 4);
+		__m128i px = _mm_loadu_si128(p);
+		if (conversions & PIXEL_PREMULTIPLY_ALPHA) {
+			__m128i lo = PremultiplyHalf(_mm_unpacklo_epi8(px, zero));
+			__m128i hi = PremultiplyHalf(_mm_unpackhi_epi8(px, zero));
+			px = _mm_or_si128(_mm_andnot_si128(alphaMask, _mm_packus_epi16(lo, hi)), _mm_and_si128(px, alphaMask));
+		}
+		if (conversions & PIXEL_SWIZZLE_BGRA) {
+			__m128i rb = _mm_and_si128(px, rbMask);
+			px = _mm_or_si128(_mm_and_si128(px, agMask), _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16)));
+		}
+		_mm_storeu_si128(p, px);
+	}
+	return i;
+}
+
+const char *PixelConvertPath() { return "sse2"; }
+
+#elif defined(PIXEL_CONVERT_AVX2)
+
+static inline __m256i PremultiplyHalf(__m256i px) {
+	__m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(px, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+	__m256i t = _mm256_add_epi16(_mm256_mullo_epi16(px, alpha), _mm256_set1_epi16(128));
+	return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+static int ConvertSimd(unsigned char *pixels, int pixelCount, unsigned int conversions) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i alphaMask = _mm256_set1_epi32((int) 0xFF000000);
+	const __m256i swizzle = _mm256_setr_epi8(
+		2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+		2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+	int i = 0;
+	for (; i + 8 <= pixelCount; i += 8) {
+		__m256i *p = (__m256i *) (pixels + i * 4);
+		__m256i px = _mm256_loadu_si256(p);
+		if (conversions & PIXEL_PREMULTIPLY_ALPHA) {
+			// unpack and pack both work per 128 bit lane, so pixel order survives the round trip
+			__m256i lo = PremultiplyHalf(_mm256_unpacklo_epi8(px, zero));
+			__m256i hi = PremultiplyHalf(_mm256_unpackhi_epi8(px, zero));
+			px = _mm256_or_si256(_mm256_andnot_si256(alphaMask, _mm256_packus_epi16(lo, hi)), _mm256_and_si256(px, alphaMask));
+		}
+		if (conversions & PIXEL_SWIZZLE_BGRA) {
+			px = _mm256_shuffle_epi8(px, swizzle);
+		}
+		_mm256_storeu_si256(p, px);
+	}
+	return i;
+}
+
+const char *PixelConvertPath() { return "avx2"; }
+
+#elif defined(PIXEL_CONVERT_NEON)
+
+static inline uint8x8_t MultiplyAlphaNeon(uint8x8_t c, uint8x8_t a) {
+	uint16x8_t t = vaddq_u16(vmull_u8(c, a), vdupq_n_u16(128));
+	return vaddhn_u16(t, vshrq_n_u16(t, 8));
+}
+
+static inline uint8x16_t MultiplyAlphaNeon(uint8x16_t c, uint8x16_t a) {
+	return vcombine_u8(MultiplyAlphaNeon(vget_low_u8(c), vget_low_u8(a)), MultiplyAlphaNeon(vget_high_u8(c), vget_high_u8(a)));
+}
+
+static int ConvertSimd(unsigned char *pixels, int pixelCount, unsigned int conversions) {
+	int i = 0;
+	for (; i + 16 <= pixelCount; i += 16) {
+		unsigned char *p = pixels + i * 4;
+		uint8x16x4_t px = vld4q_u8(p);
+		if (conversions & PIXEL_PREMULTIPLY_ALPHA) {
+			px.val[0] = MultiplyAlphaNeon(px.val[0], px.val[3]);
+			px.val[1] = MultiplyAlphaNeon(px.val[1], px.val[3]);
+			px.val[2] = MultiplyAlphaNeon(px.val[2], px.val[3]);
+		}
+		if (conversions & PIXEL_SWIZZLE_BGRA) {
+			uint8x16_t r = px.val[0];
+			px.val[0] = px.val[2];
+			px.val[2] = r;
+		}
+		vst4q_u8(p, px);
+	}
+	return i;
+}
+
+const char *PixelConvertPath() { return "neon"; }
+
+#else
+
+static int ConvertSimd(unsigned char *pixels, int pixelCount, unsigned int conversions) {
+	return 0;
+}
+
+const char *PixelConvertPath() { return "scalar"; }
+
+#endif
+
+void ConvertPixels(unsigned char *pixels, int pixelCount, unsigned int conversions) {
+	if (conversions & PIXEL_SRGB_TO_LINEAR) {
+		SrgbToLinear(pixels, pixelCount);
+	}
+	if (conversions & (PIXEL_PREMULTIPLY_ALPHA | PIXEL_SWIZZLE_BGRA)) {
+		int done = ConvertSimd(pixels, pixelCount, conversions);
+		ConvertTail(pixels + done * 4, pixelCount - done, conversions);
+	}
+}
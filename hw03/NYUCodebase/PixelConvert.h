@@ -0,0 +1,15 @@
+#pragma once
+
+// Conversions applied to decoded RGBA8 pixels before they are uploaded.
+// They run in the order sRGB->linear, premultiply, swizzle.
+enum PixelConversion {
+	PIXEL_SRGB_TO_LINEAR = 1 << 0,
+	PIXEL_PREMULTIPLY_ALPHA = 1 << 1,
+	PIXEL_SWIZZLE_BGRA = 1 << 2
+};
+
+void ConvertPixels(unsigned char *pixels, int pixelCount, unsigned int conversions);
+void ConvertPixelsScalar(unsigned char *pixels, int pixelCount, unsigned int conversions);
+
+// Name of the SIMD path ConvertPixels was compiled with ("avx2", "sse2", "neon" or "scalar").
+const char *PixelConvertPath();
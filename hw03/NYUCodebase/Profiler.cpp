@@ -0,0 +1,96 @@
+
+#include "Profiler.h"
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+struct ThreadEvents {
+	int thread;
+	const char *name;
+	std::atomic<unsigned long long> written{ 0 };
+	ProfileEvent events[PROFILER_RING_SIZE];
+};
+
+std::atomic<bool> Profiler::enabled{ false };
+
+static std::mutex threadsMutex;
+static std::vector<ThreadEvents *> threads;
+
+static ThreadEvents *GetThreadEvents() {
+	// Registered once per thread; the buffers live until exit so an export never sees a dangling one
+	thread_local ThreadEvents *buffer = NULL;
+	if (buffer == NULL) {
+		buffer = new ThreadEvents();
+		buffer->name = NULL;
+		std::lock_guard<std::mutex> lock(threadsMutex);
+		buffer->thread = (int) threads.size();
+		threads.push_back(buffer);
+	}
+	return buffer;
+}
+
+void Profiler::SetThreadName(const char *name) {
+	GetThreadEvents()->name = name;
+}
+
+void Profiler::Enable(bool enabled) {
+	Profiler::enabled = enabled;
+}
+
+long long Profiler::Now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::Record(const char *name, long long begin, long long end) {
+	ThreadEvents *buffer = GetThreadEvents();
+	unsigned long long index = buffer->written.load(std::memory_order_relaxed);
+	ProfileEvent &event = buffer->events[index % PROFILER_RING_SIZE];
+	event.name = name;
+	event.begin = begin;
+	event.end = end;
+	buffer->written.store(index + 1, std::memory_order_release);
+}
+
+bool Profiler::ExportChromeTrace(const char *filePath) {
+	std::ofstream outfile(filePath);
+	if (outfile.fail()) {
+		std::cout << "Unable to write profile to " << filePath << std::endl;
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(threadsMutex);
+	long long origin = 0;
+	for (size_t i = 0; i < threads.size(); i++) {
+		unsigned long long written = threads[i]->written.load(std::memory_order_acquire);
+		unsigned long long start = written > PROFILER_RING_SIZE ? written - PROFILER_RING_SIZE : 0;
+		for (unsigned long long j = start; j < written; j++) {
+			long long begin = threads[i]->events[j % PROFILER_RING_SIZE].begin;
+			if (origin == 0 || begin < origin) {
+				origin = begin;
+			}
+		}
+	}
+
+	// Complete ("X") events with microsecond timestamps, as read by chrome://tracing and Perfetto
+	outfile << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+	for (size_t i = 0; i < threads.size(); i++) {
+		ThreadEvents *buffer = threads[i];
+		outfile << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->thread
+			<< ",\"args\":{\"name\":\"" << (buffer->name ? buffer->name : "thread") << "\"}}";
+		first = false;
+
+		unsigned long long written = buffer->written.load(std::memory_order_acquire);
+		unsigned long long start = written > PROFILER_RING_SIZE ? written - PROFILER_RING_SIZE : 0;
+		for (unsigned long long j = start; j < written; j++) {
+			const ProfileEvent &event = buffer->events[j % PROFILER_RING_SIZE];
+			outfile << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->thread
+				<< ",\"ts\":" << (event.begin - origin) / 1000.0 << ",\"dur\":" << (event.end - event.begin) / 1000.0 << "}";
+		}
+	}
+	outfile << "\n]}\n";
+	return true;
+}
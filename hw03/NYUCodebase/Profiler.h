@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+
+#define PROFILER_RING_SIZE 65536
+
+struct ProfileEvent {
+	const char *name;
+	long long begin;
+	long long end;
+};
+
+// Collects timed zones into a ring buffer per thread. Recording takes no locks;
+// ExportChromeTrace should run once the recording threads are idle.
+class Profiler {
+public:
+	static void Enable(bool enabled);
+	static void SetThreadName(const char *name);
+	static bool IsEnabled() { return enabled.load(std::memory_order_relaxed); }
+	static long long Now();
+	static void Record(const char *name, long long begin, long long end);
+	static bool ExportChromeTrace(const char *filePath);
+
+private:
+	static std::atomic<bool> enabled;
+};
+
+class ProfileZone {
+public:
+	ProfileZone(const char *name) : name(name), begin(Profiler::IsEnabled() ? Profiler::Now() : 0) {}
+	~ProfileZone() {
+		if (begin != 0) {
+			Profiler::Record(name, begin, Profiler::Now());
+		}
+	}
+
+private:
+	const char *name;
+	long long begin;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef DISABLE_PROFILER
+	#define PROFILE_ZONE(name)
+#else
+	#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#endif
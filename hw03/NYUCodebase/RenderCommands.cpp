@@ -0,0 +1,74 @@
+
+#include "RenderCommands.h"
+#include <cstring>
+
+void RenderCommandBuffer::SetCamera(float x, float y, float halfWidth, float halfHeight) {
+	RenderCommand command;
+	command.type = COMMAND_SET_CAMERA;
+	command.camera.x = x;
+	command.camera.y = y;
+	command.camera.halfWidth = halfWidth;
+	command.camera.halfHeight = halfHeight;
+	commands.push_back(command);
+}
+
+void RenderCommandBuffer::DrawSprite(float x, float y, float rotation, float scaleX, float scaleY, SpriteId sprite) {
+	RenderCommand command;
+	command.type = COMMAND_DRAW_SPRITE;
+	command.sprite.x = x;
+	command.sprite.y = y;
+	command.sprite.rotation = rotation;
+	command.sprite.scaleX = scaleX;
+	command.sprite.scaleY = scaleY;
+	command.sprite.sprite = sprite;
+	commands.push_back(command);
+}
+
+void RenderCommandBuffer::DrawText(const char *text, int texture, float x, float y, float size, float spacing) {
+	RenderCommand command;
+	command.type = COMMAND_DRAW_TEXT;
+	command.text.x = x;
+	command.text.y = y;
+	command.text.size = size;
+	command.text.spacing = spacing;
+	command.text.texture = texture;
+	command.text.first = (unsigned int) textData.size();
+	command.text.length = (unsigned int) strlen(text);
+	commands.push_back(command);
+	textData.insert(textData.end(), text, text + command.text.length + 1);
+}
+
+void RenderCommandBuffer::DrawParticles(SpriteId sprite, const float *x, const float *y, const float *alpha, int count) {
+	if (count <= 0) {
+		return;
+	}
+	RenderCommand command;
+	command.type = COMMAND_DRAW_PARTICLES;
+	command.particles.sprite = sprite;
+	command.particles.first = (unsigned int) (particleData.size() / 3);
+	command.particles.count = (unsigned int) count;
+	commands.push_back(command);
+
+	size_t offset = particleData.size();
+	particleData.resize(offset + count * 3);
+	float *data = particleData.data() + offset;
+	for (int i = 0; i < count; i++) {
+		data[i * 3] = x[i];
+		data[i * 3 + 1] = y[i];
+		data[i * 3 + 2] = alpha[i];
+	}
+}
+
+void RenderCommandFrame::Clear() {
+	for (int i = 0; i < MAX_RENDER_PRODUCERS; i++) {
+		buffers[i].Clear();
+	}
+}
+
+size_t RenderCommandFrame::Size() const {
+	size_t size = 0;
+	for (int i = 0; i < MAX_RENDER_PRODUCERS; i++) {
+		size += buffers[i].Size();
+	}
+	return size;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "SpriteTable.h"
+#include <cstddef>
+#include <vector>
+
+#define MAX_RENDER_PRODUCERS 4
+
+enum RenderCommandType { COMMAND_SET_CAMERA, COMMAND_DRAW_SPRITE, COMMAND_DRAW_TEXT, COMMAND_DRAW_PARTICLES };
+
+struct CameraCommand {
+	float x, y;
+	float halfWidth, halfHeight;
+};
+
+struct SpriteCommand {
+	float x, y;
+	float rotation;
+	float scaleX, scaleY;
+	SpriteId sprite;
+};
+
+// The characters live in the owning buffer's text data, null terminated, starting at first.
+struct TextCommand {
+	float x, y;
+	float size, spacing;
+	int texture;
+	unsigned int first;
+	unsigned int length;
+};
+
+// One sprite drawn at many points; the points live in the owning buffer's
+// particle data as x, y, alpha triples starting at first.
+struct ParticleCommand {
+	SpriteId sprite;
+	unsigned int first;
+	unsigned int count;
+};
+
+// Plain data only, so buffers can be copied between threads and replayed by any backend.
+struct RenderCommand {
+	RenderCommandType type;
+	union {
+		CameraCommand camera;
+		SpriteCommand sprite;
+		TextCommand text;
+		ParticleCommand particles;
+	};
+};
+
+class RenderCommandBuffer {
+public:
+	void SetCamera(float x, float y, float halfWidth, float halfHeight);
+	void DrawSprite(float x, float y, float rotation, float scaleX, float scaleY, SpriteId sprite);
+	void DrawText(const char *text, int texture, float x, float y, float size, float spacing);
+	void DrawParticles(SpriteId sprite, const float *x, const float *y, const float *alpha, int count);
+	void Clear() { commands.clear(); particleData.clear(); textData.clear(); }
+
+	size_t Size() const { return commands.size(); }
+	const RenderCommand &operator[](size_t index) const { return commands[index]; }
+	const float *ParticleData(const ParticleCommand &command) const { return particleData.data() + command.first * 3; }
+	const char *Text(const TextCommand &command) const { return textData.data() + command.first; }
+
+private:
+	std::vector<RenderCommand> commands;
+	std::vector<float> particleData;
+	std::vector<char> textData;
+};
+
+// The commands for one frame. Each producer thread records into the buffers with
+// its own indices, so no two threads ever touch the same buffer and recording needs
+// no locks; once all producers are done the backend reads the buffers in index order.
+class RenderCommandFrame {
+public:
+	RenderCommandBuffer &Producer(int index) { return buffers[index]; }
+	void Clear();
+
+	size_t Size() const;
+	const RenderCommandBuffer &Buffer(int index) const { return buffers[index]; }
+
+private:
+	RenderCommandBuffer buffers[MAX_RENDER_PRODUCERS];
+};
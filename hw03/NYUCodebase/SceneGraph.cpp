@@ -0,0 +1,124 @@
+
+#include "SceneGraph.h"
+#include <algorithm>
+
+// A new node goes after every node of its depth, which is also after its parent.
+// Only the nodes after it move, so adding to the deepest level is a push_back.
+SceneNode SceneGraph::Create(SceneNode parent) {
+	int parentSlot = parent == NO_SCENE_NODE ? -1 : slots[parent];
+	int depth = parentSlot < 0 ? 0 : depths[parentSlot] + 1;
+	int slot = (int) (std::upper_bound(depths.begin(), depths.end(), depth) - depths.begin());
+
+	SceneNode node;
+	if (!freeNodes.empty()) {
+		node = freeNodes.back();
+		freeNodes.pop_back();
+	} else {
+		node = (SceneNode) slots.size();
+		slots.push_back(-1);
+	}
+
+	// Parents come before children, so only nodes after the new one can have a parent that moves
+	for (size_t i = slot; i < parents.size(); i++) {
+		if (parents[i] >= slot) {
+			parents[i]++;
+		}
+	}
+	for (size_t i = slot; i < nodes.size(); i++) {
+		slots[nodes[i]]++;
+	}
+
+	LocalTransform local = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f };
+	parents.insert(parents.begin() + slot, parentSlot);
+	depths.insert(depths.begin() + slot, depth);
+	locals.insert(locals.begin() + slot, local);
+	worlds.insert(worlds.begin() + slot, Affine2D::Make(0.0f, 0.0f, 0.0f, 1.0f, 1.0f));
+	dirty.insert(dirty.begin() + slot, 1);
+	nodes.insert(nodes.begin() + slot, node);
+	slots[node] = slot;
+	return node;
+}
+
+// Removes the node and everything below it. Descendants are always deeper, so
+// one pass from the node onwards finds them all, and nodes before it stay put.
+// remap is kept between calls so removing never allocates once it has grown.
+void SceneGraph::Destroy(SceneNode node) {
+	int first = slots[node];
+	int count = (int) parents.size();
+	remap.resize(count - first);
+
+	int kept = first;
+	for (int i = first; i < count; i++) {
+		int parent = parents[i];
+		if (i == first || (parent >= first && remap[parent - first] < 0)) {
+			remap[i - first] = -1;
+			slots[nodes[i]] = -1;
+			freeNodes.push_back(nodes[i]);
+			continue;
+		}
+		remap[i - first] = kept;
+		parents[kept] = parent < first ? parent : remap[parent - first];
+		depths[kept] = depths[i];
+		locals[kept] = locals[i];
+		worlds[kept] = worlds[i];
+		dirty[kept] = dirty[i];
+		nodes[kept] = nodes[i];
+		slots[nodes[kept]] = kept;
+		kept++;
+	}
+	parents.resize(kept);
+	depths.resize(kept);
+	locals.resize(kept);
+	worlds.resize(kept);
+	dirty.resize(kept);
+	nodes.resize(kept);
+}
+
+void SceneGraph::Clear() {
+	parents.clear();
+	depths.clear();
+	locals.clear();
+	worlds.clear();
+	dirty.clear();
+	nodes.clear();
+	slots.clear();
+	freeNodes.clear();
+}
+
+void SceneGraph::SetTransform(SceneNode node, float x, float y, float rotation, float scaleX, float scaleY) {
+	int slot = slots[node];
+	LocalTransform local = { x, y, rotation, scaleX, scaleY };
+	locals[slot] = local;
+	dirty[slot] = 1;
+}
+
+void SceneGraph::SetPosition(SceneNode node, float x, float y) {
+	int slot = slots[node];
+	locals[slot].x = x;
+	locals[slot].y = y;
+	dirty[slot] = 1;
+}
+
+void SceneGraph::Translate(SceneNode node, float dx, float dy) {
+	int slot = slots[node];
+	locals[slot].x += dx;
+	locals[slot].y += dy;
+	dirty[slot] = 1;
+}
+
+// A node is recomputed when it or its parent changed this pass. Parents come
+// first, so a dirty flag spreads down a whole subtree in the same loop.
+void SceneGraph::Update() {
+	for (size_t i = 0; i < parents.size(); i++) {
+		int parent = parents[i];
+		if (!dirty[i] && (parent < 0 || !dirty[parent])) {
+			continue;
+		}
+		dirty[i] = 1;
+		const LocalTransform &local = locals[i];
+		Affine2D transform = Affine2D::Make(local.x, local.y, local.rotation, local.scaleX, local.scaleY);
+		worlds[i] = parent < 0 ? transform : worlds[parent] * transform;
+		worldUpdates++;
+	}
+	std::fill(dirty.begin(), dirty.end(), 0);
+}
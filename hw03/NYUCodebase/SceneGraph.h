@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Affine2D.h"
+#include <cstddef>
+#include <vector>
+
+#define NO_SCENE_NODE -1
+
+typedef int SceneNode;
+
+// Parent/child transforms kept in flat arrays sorted by depth, so every parent
+// comes before its children and one pass in order can build world transforms.
+// Setting a local transform only marks the node dirty; Update() recomputes the
+// world transform of dirty nodes and everything below them and skips the rest.
+// SceneNode handles stay valid while nodes are inserted and removed around them.
+class SceneGraph {
+public:
+	SceneNode Create(SceneNode parent = NO_SCENE_NODE);
+	void Destroy(SceneNode node);
+	void Clear();
+
+	void SetTransform(SceneNode node, float x, float y, float rotation = 0.0f, float scaleX = 1.0f, float scaleY = 1.0f);
+	void SetPosition(SceneNode node, float x, float y);
+	void Translate(SceneNode node, float dx, float dy);
+	float LocalX(SceneNode node) const { return locals[slots[node]].x; }
+	float LocalY(SceneNode node) const { return locals[slots[node]].y; }
+
+	void Update();
+	const Affine2D &World(SceneNode node) const { return worlds[slots[node]]; }
+
+	size_t Size() const { return parents.size(); }
+	unsigned int worldUpdates = 0;
+
+private:
+	struct LocalTransform {
+		float x, y;
+		float rotation;
+		float scaleX, scaleY;
+	};
+
+	// Indexed by slot, in depth order
+	std::vector<int> parents;
+	std::vector<int> depths;
+	std::vector<LocalTransform> locals;
+	std::vector<Affine2D> worlds;
+	std::vector<unsigned char> dirty;
+	std::vector<SceneNode> nodes;
+
+	// Indexed by SceneNode
+	std::vector<int> slots;
+	std::vector<SceneNode> freeNodes;
+
+	// Destroy's scratch space: new slot of each node from the destroyed one on, -1 if removed
+	std::vector<int> remap;
+};
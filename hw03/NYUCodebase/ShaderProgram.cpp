@@ -3,6 +3,10 @@
 
 void ShaderProgram::Load(const char *vertexShaderFile, const char *fragmentShaderFile) {
     
+    vertexShaderPath = vertexShaderFile;
+    fragmentShaderPath = fragmentShaderFile;
+    infoLog.clear();
+    
     // create the vertex shader
     vertexShader = LoadShaderFromFile(vertexShaderFile, GL_VERTEX_SHADER);
     // create the fragment shader
@@ -19,7 +23,54 @@ void ShaderProgram::Load(const char *vertexShaderFile, const char *fragmentShade
     if(linkSuccess == GL_FALSE) {
 	printf("Error linking shader program!\n");
     }
+    if(!infoLog.empty()) {
+        std::cout << infoLog << std::endl;
+    }
+    
+    QueryLocations();
+	
+	SetColor(1.0f, 1.0f, 1.0f, 1.0f);
+    
+}
+
+bool ShaderProgram::Reload(const std::string &vertexShaderSource, const std::string &fragmentShaderSource) {
+    
+    // Build the replacement next to the running program so a broken edit never takes it down
+    infoLog.clear();
+    GLuint newVertexShader = LoadShaderFromString(vertexShaderSource, GL_VERTEX_SHADER);
+    GLuint newFragmentShader = LoadShaderFromString(fragmentShaderSource, GL_FRAGMENT_SHADER);
+    
+    GLuint newProgramID = glCreateProgram();
+    glAttachShader(newProgramID, newVertexShader);
+    glAttachShader(newProgramID, newFragmentShader);
+    glLinkProgram(newProgramID);
+    
+    GLint linkSuccess;
+    glGetProgramiv(newProgramID, GL_LINK_STATUS, &linkSuccess);
+    if(linkSuccess == GL_FALSE) {
+        GLchar messages[512];
+        glGetProgramInfoLog(newProgramID, sizeof(messages), 0, &messages[0]);
+        infoLog += messages;
+        glDeleteProgram(newProgramID);
+        glDeleteShader(newVertexShader);
+        glDeleteShader(newFragmentShader);
+        return false;
+    }
     
+    Cleanup();
+    programID = newProgramID;
+    vertexShader = newVertexShader;
+    fragmentShader = newFragmentShader;
+    QueryLocations();
+    
+    // Uniform values belong to the old program object, so carry them over
+    SetProjectionMatrix(projectionMatrix);
+    SetViewMatrix(viewMatrix);
+    SetColor(color.r, color.g, color.b, color.a);
+    return true;
+}
+
+void ShaderProgram::QueryLocations() {
     modelMatrixUniform = glGetUniformLocation(programID, "modelMatrix");
     projectionMatrixUniform = glGetUniformLocation(programID, "projectionMatrix");
     viewMatrixUniform = glGetUniformLocation(programID, "viewMatrix");
@@ -27,9 +78,6 @@ void ShaderProgram::Load(const char *vertexShaderFile, const char *fragmentShade
     
     positionAttribute = glGetAttribLocation(programID, "position");
     texCoordAttribute = glGetAttribLocation(programID, "texCoord");
-	
-	SetColor(1.0f, 1.0f, 1.0f, 1.0f);
-    
 }
 
 void ShaderProgram::Cleanup() {
@@ -72,11 +120,11 @@ GLuint ShaderProgram::LoadShaderFromString(const std::string &shaderContents, GL
     GLint compileSuccess;
     glGetShaderiv(shaderID, GL_COMPILE_STATUS, &compileSuccess);
     
-    // If the shader did not compile, print the error to stdout
+    // If the shader did not compile, keep the error for the caller to report
     if (compileSuccess == GL_FALSE) {
         GLchar messages[512];
         glGetShaderInfoLog(shaderID, sizeof(messages), 0, &messages[0]);
-        std::cout << messages << std::endl;
+        infoLog += messages;
     }
     
     // return the shader id
@@ -84,11 +132,13 @@ GLuint ShaderProgram::LoadShaderFromString(const std::string &shaderContents, GL
 }
 
 void ShaderProgram::SetColor(float r, float g, float b, float a) {
+	color = glm::vec4(r, g, b, a);
 	glUseProgram(programID);
 	glUniform4f(colorUniform, r, g, b, a);
 }
 
 void ShaderProgram::SetViewMatrix(const glm::mat4 &matrix) {
+    viewMatrix = matrix;
     glUseProgram(programID);
     glUniformMatrix4fv(viewMatrixUniform, 1, GL_FALSE, &matrix[0][0]);
 }
@@ -99,6 +149,7 @@ void ShaderProgram::SetModelMatrix(const glm::mat4 &matrix) {
 }
 
 void ShaderProgram::SetProjectionMatrix(const glm::mat4 &matrix) {
+    projectionMatrix = matrix;
     glUseProgram(programID);
     glUniformMatrix4fv(projectionMatrixUniform, 1, GL_FALSE, &matrix[0][0]);    
 }
@@ -10,11 +10,13 @@
 #include <fstream>
 #include <sstream>
 #include "glm/mat4x4.hpp"
+#include "glm/vec4.hpp"
 
 class ShaderProgram {
     public:
 	
 		void Load(const char *vertexShaderFile, const char *fragmentShaderFile);
+		bool Reload(const std::string &vertexShaderSource, const std::string &fragmentShaderSource);
 		void Cleanup();
 
 		void SetModelMatrix(const glm::mat4 &matrix);
@@ -25,6 +27,7 @@ class ShaderProgram {
 	
         GLuint LoadShaderFromString(const std::string &shaderContents, GLenum type);
         GLuint LoadShaderFromFile(const std::string &shaderFile, GLenum type);
+        void QueryLocations();
     
         GLuint programID;
     
@@ -38,4 +41,12 @@ class ShaderProgram {
     
         GLuint vertexShader;
         GLuint fragmentShader;
+    
+        std::string vertexShaderPath;
+        std::string fragmentShaderPath;
+        std::string infoLog;
+    
+        glm::mat4 projectionMatrix;
+        glm::mat4 viewMatrix;
+        glm::vec4 color;
 };
@@ -0,0 +1,172 @@
+
+#include "ShaderWatcher.h"
+#include <chrono>
+#include <map>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
+
+static std::string DirectoryOf(const std::string &path) {
+	size_t slash = path.find_last_of("/\\");
+	return slash == std::string::npos ? "." : path.substr(0, slash);
+}
+
+static std::string NormalizePath(const std::string &path) {
+	size_t slash = path.find_last_of("/\\");
+	return DirectoryOf(path) + "/" + (slash == std::string::npos ? path : path.substr(slash + 1));
+}
+
+ShaderWatcher::~ShaderWatcher() {
+	Stop();
+}
+
+void ShaderWatcher::Watch(ShaderProgram *program) {
+	WatchedProgram watched;
+	watched.program = program;
+	watched.pending = false;
+	programs.push_back(watched);
+}
+
+void ShaderWatcher::Start() {
+	if (running) {
+		return;
+	}
+	running = true;
+	thread = std::thread(&ShaderWatcher::Run, this);
+}
+
+void ShaderWatcher::Stop() {
+	running = false;
+	if (thread.joinable()) {
+		thread.join();
+	}
+}
+
+void ShaderWatcher::Poll() {
+	if (!changed.exchange(false)) {
+		return;
+	}
+
+	std::vector<WatchedProgram> ready;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (size_t i = 0; i < programs.size(); i++) {
+			if (programs[i].pending) {
+				ready.push_back(programs[i]);
+				programs[i].pending = false;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < ready.size(); i++) {
+		ShaderProgram *program = ready[i].program;
+		if (program->Reload(ready[i].vertexSource, ready[i].fragmentSource)) {
+			std::cout << "Reloaded shader " << program->vertexShaderPath << " + " << program->fragmentShaderPath << std::endl;
+		} else {
+			std::cout << "Failed to reload shader " << program->vertexShaderPath << " + " << program->fragmentShaderPath
+				<< ", keeping the previous program" << std::endl << program->infoLog << std::endl;
+		}
+	}
+}
+
+bool ShaderWatcher::ReadFile(const std::string &path, std::string &contents) {
+	std::ifstream infile(path);
+	if (infile.fail()) {
+		return false;
+	}
+	std::stringstream buffer;
+	buffer << infile.rdbuf();
+	contents = buffer.str();
+	return true;
+}
+
+void ShaderWatcher::FileChanged(const std::string &path) {
+	for (size_t i = 0; i < programs.size(); i++) {
+		ShaderProgram *program = programs[i].program;
+		if (NormalizePath(program->vertexShaderPath) != path && NormalizePath(program->fragmentShaderPath) != path) {
+			continue;
+		}
+
+		std::string vertexSource, fragmentSource;
+		if (!ReadFile(program->vertexShaderPath, vertexSource) || !ReadFile(program->fragmentShaderPath, fragmentSource)) {
+			continue;
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		programs[i].vertexSource = vertexSource;
+		programs[i].fragmentSource = fragmentSource;
+		programs[i].pending = true;
+		changed = true;
+	}
+}
+
+#ifdef __linux__
+
+void ShaderWatcher::Run() {
+	int fd = inotify_init1(IN_NONBLOCK);
+	if (fd < 0) {
+		std::cout << "Unable to start shader watcher" << std::endl;
+		return;
+	}
+
+	// Editors often save through a temporary file and a rename, so watch directories rather than files
+	std::map<int, std::string> directories;
+	for (size_t i = 0; i < programs.size(); i++) {
+		const std::string paths[] = { programs[i].program->vertexShaderPath, programs[i].program->fragmentShaderPath };
+		for (int j = 0; j < 2; j++) {
+			int wd = inotify_add_watch(fd, DirectoryOf(paths[j]).c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+			if (wd >= 0) {
+				directories[wd] = DirectoryOf(paths[j]);
+			}
+		}
+	}
+
+	char buffer[4096];
+	while (running) {
+		pollfd pfd = { fd, POLLIN, 0 };
+		if (poll(&pfd, 1, 200) <= 0) {
+			continue;
+		}
+		ssize_t length = read(fd, buffer, sizeof(buffer));
+		for (ssize_t offset = 0; offset < length;) {
+			const inotify_event *event = (const inotify_event *) (buffer + offset);
+			if (event->len > 0 && directories.count(event->wd)) {
+				FileChanged(directories[event->wd] + "/" + event->name);
+			}
+			offset += sizeof(inotify_event) + event->len;
+		}
+	}
+	close(fd);
+}
+
+#else
+
+void ShaderWatcher::Run() {
+	// No inotify here, fall back to polling modification times
+	std::map<std::string, time_t> modified;
+	while (running) {
+		for (size_t i = 0; i < programs.size(); i++) {
+			const std::string paths[] = { programs[i].program->vertexShaderPath, programs[i].program->fragmentShaderPath };
+			for (int j = 0; j < 2; j++) {
+				struct stat info;
+				if (stat(paths[j].c_str(), &info) != 0) {
+					continue;
+				}
+				std::map<std::string, time_t>::iterator it = modified.find(paths[j]);
+				if (it != modified.end() && it->second != info.st_mtime) {
+					FileChanged(NormalizePath(paths[j]));
+				}
+				modified[paths[j]] = info.st_mtime;
+			}
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(250));
+	}
+}
+
+#endif
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ShaderProgram.h"
+
+// Watches the source files of loaded shader programs from a background thread.
+// Changed sources are read off the main thread; the GL work happens in Poll(),
+// which swaps the new program in between frames or keeps the old one on failure.
+class ShaderWatcher {
+public:
+	~ShaderWatcher();
+
+	void Watch(ShaderProgram *program);
+	void Start();
+	void Stop();
+	void Poll();
+
+private:
+	struct WatchedProgram {
+		ShaderProgram *program;
+		bool pending;
+		std::string vertexSource;
+		std::string fragmentSource;
+	};
+
+	void Run();
+	void FileChanged(const std::string &path);
+	bool ReadFile(const std::string &path, std::string &contents);
+
+	std::vector<WatchedProgram> programs;
+	std::mutex mutex;
+	std::thread thread;
+	std::atomic<bool> running{ false };
+	std::atomic<bool> changed{ false };
+};
@@ -0,0 +1,74 @@
+
+#include "SpriteAtlas.h"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// Returns the value of attribute `name` inside the tag [begin, end), or an empty string.
+static std::string ReadAttribute(const char *begin, const char *end, const char *name) {
+	size_t length = strlen(name);
+	for (const char *p = begin; p + length + 2 < end; p++) {
+		if (p > begin && p[-1] != ' ' && p[-1] != '\t' && p[-1] != '\n' && p[-1] != '\r') {
+			continue;
+		}
+		if (strncmp(p, name, length) == 0 && p[length] == '=' && p[length + 1] == '"') {
+			const char *value = p + length + 2;
+			const char *close = value;
+			while (close < end && *close != '"') {
+				close++;
+			}
+			return std::string(value, close);
+		}
+	}
+	return std::string();
+}
+
+bool SpriteAtlas::Load(const char *filePath) {
+	std::ifstream infile(filePath);
+	if (infile.fail()) {
+		std::cout << "Unable to open sprite atlas " << filePath << std::endl;
+		return false;
+	}
+	std::stringstream buffer;
+	buffer << infile.rdbuf();
+	return Parse(buffer.str());
+}
+
+bool SpriteAtlas::Parse(const std::string &xml) {
+	imagePath.clear();
+	regions.clear();
+	lookup.clear();
+
+	const char *text = xml.c_str();
+	const char *end = text + xml.size();
+	const char *tag = strstr(text, "<TextureAtlas");
+	if (tag == NULL) {
+		std::cout << "Sprite atlas has no TextureAtlas element" << std::endl;
+		return false;
+	}
+	const char *tagEnd = strchr(tag, '>');
+	imagePath = ReadAttribute(tag, tagEnd ? tagEnd : end, "imagePath");
+
+	while ((tag = strstr(tag + 1, "<SubTexture")) != NULL) {
+		tagEnd = strchr(tag, '>');
+		if (tagEnd == NULL) {
+			break;
+		}
+		AtlasRegion region;
+		region.name = ReadAttribute(tag, tagEnd, "name");
+		region.x = atoi(ReadAttribute(tag, tagEnd, "x").c_str());
+		region.y = atoi(ReadAttribute(tag, tagEnd, "y").c_str());
+		region.width = atoi(ReadAttribute(tag, tagEnd, "width").c_str());
+		region.height = atoi(ReadAttribute(tag, tagEnd, "height").c_str());
+		lookup[region.name] = regions.size();
+		regions.push_back(region);
+	}
+	return true;
+}
+
+const AtlasRegion *SpriteAtlas::Find(const std::string &name) const {
+	std::unordered_map<std::string, size_t>::const_iterator it = lookup.find(name);
+	return it == lookup.end() ? NULL : &regions[it->second];
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct AtlasRegion {
+	std::string name;
+	int x;
+	int y;
+	int width;
+	int height;
+};
+
+// Sub-image rectangles from a TextureAtlas xml file such as sheet.xml.
+class SpriteAtlas {
+public:
+	bool Load(const char *filePath);
+	bool Parse(const std::string &xml);
+	const AtlasRegion *Find(const std::string &name) const;
+
+	std::string imagePath;
+	std::vector<AtlasRegion> regions;
+
+private:
+	std::unordered_map<std::string, size_t> lookup;
+};
@@ -0,0 +1,40 @@
+
+#include "SpriteTable.h"
+#include <iostream>
+
+SpriteId SpriteTable::Add(unsigned int textureID, float u, float v, float width, float height, float size) {
+	if (count >= MAX_SPRITES) {
+		std::cout << "Sprite table is full, raise MAX_SPRITES" << std::endl;
+		return INVALID_SPRITE;
+	}
+	SpriteDefinition &sprite = definitions[count];
+	sprite.textureID = textureID;
+	sprite.u = u;
+	sprite.v = v;
+	sprite.width = width;
+	sprite.height = height;
+	sprite.size = size;
+
+	float aspect = height > 0.0f ? width / height : 1.0f;
+	sprite.halfWidth = 0.5f * size * aspect;
+	sprite.halfHeight = 0.5f * size;
+	float vertices[] = {
+		-sprite.halfWidth, -sprite.halfHeight,
+		sprite.halfWidth, sprite.halfHeight,
+		-sprite.halfWidth, sprite.halfHeight,
+		sprite.halfWidth, sprite.halfHeight,
+		-sprite.halfWidth, -sprite.halfHeight,
+		sprite.halfWidth, -sprite.halfHeight };
+	float texCoords[] = {
+		u, v + height,
+		u + width, v,
+		u, v,
+		u + width, v,
+		u, v + height,
+		u + width, v + height };
+	for (int i = 0; i < 12; i++) {
+		sprite.vertices[i] = vertices[i];
+		sprite.texCoords[i] = texCoords[i];
+	}
+	return (SpriteId) count++;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+
+#define MAX_SPRITES 256
+#define INVALID_SPRITE 0xffff
+
+typedef unsigned short SpriteId;
+
+// Everything needed to draw one sprite, worked out once when it is defined:
+// the quad's vertices around its centre and its texture coordinates, both in
+// the order SpriteTable draws them. width and height are the sheet-relative
+// size, halfWidth and halfHeight the size in the world.
+struct SpriteDefinition {
+	unsigned int textureID;
+	float u, v, width, height, size;
+	float halfWidth, halfHeight;
+	float vertices[12];
+	float texCoords[12];
+};
+
+// Immutable sprite definitions shared by every entity that shows them, so an
+// entity only carries a 16 bit id. Definitions are only ever appended to a
+// fixed array and never change or move, which keeps an id safe to hand to the
+// render thread.
+class SpriteTable {
+public:
+	SpriteId Add(unsigned int textureID, float u, float v, float width, float height, float size);
+
+	const SpriteDefinition &operator[](SpriteId id) const { return definitions[id]; }
+	size_t Size() const { return count; }
+
+private:
+	SpriteDefinition definitions[MAX_SPRITES];
+	size_t count = 0;
+};
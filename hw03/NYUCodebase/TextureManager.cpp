@@ -0,0 +1,188 @@
+
+#include "TextureManager.h"
+#include "PixelConvert.h"
+#include "Profiler.h"
+#include "stb_image.h"
+#include <cassert>
+#include <iostream>
+
+int TextureManager::Load(const char *filePath) {
+	for (size_t i = 0; i < textures.size(); i++) {
+		if (textures[i].filePath == filePath) {
+			return (int) i;
+		}
+	}
+
+	Texture texture;
+	texture.filePath = filePath;
+	texture.textureID = 0;
+	texture.resident = false;
+	texture.bytes = 0;
+	texture.lastUsedFrame = frame;
+	texture.evictedFrame = 0;
+	textures.push_back(texture);
+	MakeResident(textures.back());
+	return (int) textures.size() - 1;
+}
+
+void TextureManager::Bind(int texture) {
+	Texture &entry = textures[texture];
+	if (entry.resident) {
+		hits++;
+	} else {
+		misses++;
+		if (frame - entry.evictedFrame < TEXTURE_THRASH_FRAMES) {
+			thrashes++;
+		}
+		MakeResident(entry);
+	}
+	entry.lastUsedFrame = frame;
+	glBindTexture(GL_TEXTURE_2D, entry.textureID);
+}
+
+GLuint TextureManager::GetTextureID(int texture) {
+	Texture &entry = textures[texture];
+	if (!entry.resident) {
+		MakeResident(entry);
+	}
+	return entry.textureID;
+}
+
+void TextureManager::BeginFrame() {
+	frame++;
+	MakeRoom(0);
+}
+
+void TextureManager::SetBudget(size_t bytes) {
+	budget = bytes;
+	MakeRoom(0);
+}
+
+void TextureManager::SetCacheBudget(size_t bytes) {
+	cacheBudget = bytes;
+	TrimCache();
+}
+
+void TextureManager::Cleanup() {
+	for (size_t i = 0; i < textures.size(); i++) {
+		if (textures[i].resident) {
+			glDeleteTextures(1, &textures[i].textureID);
+		}
+	}
+	textures.clear();
+	residentBytes = 0;
+	cachedBytes = 0;
+}
+
+// Frees space before uploading so residentBytes never goes over the budget on the way.
+void TextureManager::MakeResident(Texture &texture) {
+	if (texture.pixels.empty()) {
+		Decode(texture);
+	}
+	MakeRoom(texture.bytes);
+	Upload(texture);
+	texture.resident = true;
+	residentBytes += texture.bytes;
+	if (residentBytes > peakBytes) {
+		peakBytes = residentBytes;
+	}
+	TrimCache();
+}
+
+void TextureManager::MakeRoom(size_t bytes) {
+	while (residentBytes + bytes > budget) {
+		// Evict the least recently bound texture, never one the current frame has already used
+		Texture *victim = NULL;
+		for (size_t i = 0; i < textures.size(); i++) {
+			Texture &texture = textures[i];
+			if (texture.resident && texture.lastUsedFrame != frame &&
+				(victim == NULL || texture.lastUsedFrame < victim->lastUsedFrame)) {
+				victim = &texture;
+			}
+		}
+		if (victim == NULL) {
+			return;
+		}
+		glDeleteTextures(1, &victim->textureID);
+		victim->textureID = 0;
+		victim->resident = false;
+		victim->evictedFrame = frame;
+		residentBytes -= victim->bytes;
+		evictions++;
+	}
+}
+
+// Drops the decoded pixels of the least recently bound textures. A resident
+// texture does not need them until it is evicted, so any texture can lose them.
+void TextureManager::TrimCache() {
+	while (cachedBytes > cacheBudget) {
+		Texture *victim = NULL;
+		for (size_t i = 0; i < textures.size(); i++) {
+			Texture &texture = textures[i];
+			if (!texture.pixels.empty() && (victim == NULL || texture.lastUsedFrame < victim->lastUsedFrame)) {
+				victim = &texture;
+			}
+		}
+		if (victim == NULL) {
+			return;
+		}
+		cachedBytes -= victim->pixels.size();
+		std::vector<unsigned char>().swap(victim->pixels);
+	}
+}
+
+void TextureManager::Decode(Texture &texture) {
+	PROFILE_ZONE("LoadTexture");
+	int w, h, comp;
+	unsigned char* image = stbi_load(texture.filePath.c_str(), &w, &h, &comp, STBI_rgb_alpha);
+
+	if (image == NULL) {
+		std::cout << "Unable to load image. Make sure the path is correct\n";
+		assert(false);
+	}
+
+	ConvertPixels(image, w * h, PIXEL_PREMULTIPLY_ALPHA);
+
+	texture.width = w;
+	texture.height = h;
+	texture.bytes = (size_t) w * h * 4;
+	texture.pixels.assign(image, image + texture.bytes);
+	cachedBytes += texture.bytes;
+	decodes++;
+	stbi_image_free(image);
+}
+
+void TextureManager::Upload(Texture &texture) {
+	PROFILE_ZONE("UploadTexture");
+	glGenTextures(1, &texture.textureID);
+	glBindTexture(GL_TEXTURE_2D, texture.textureID);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, texture.width, texture.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, texture.pixels.data());
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+TextureStats TextureManager::GetStats() const {
+	TextureStats stats;
+	stats.hits = hits;
+	stats.misses = misses;
+	stats.evictions = evictions;
+	stats.thrashes = thrashes;
+	stats.decodes = decodes;
+	stats.residentBytes = residentBytes;
+	stats.peakBytes = peakBytes;
+	stats.cachedBytes = cachedBytes;
+	stats.budget = budget;
+	stats.cacheBudget = cacheBudget;
+	return stats;
+}
+
+void TextureManager::PrintStats() const {
+	TextureStats stats = GetStats();
+	unsigned int binds = stats.hits + stats.misses;
+	std::cout << "textures: " << textures.size() << ", resident " << stats.residentBytes / 1024 << " KB, peak "
+		<< stats.peakBytes / 1024 << " KB, budget " << stats.budget / 1024 << " KB, decoded in system memory "
+		<< stats.cachedBytes / 1024 << " KB of " << stats.cacheBudget / 1024 << " KB" << std::endl;
+	std::cout << "texture binds: " << binds << ", hit rate " << (binds > 0 ? 100.0 * stats.hits / binds : 100.0)
+		<< "%, reloads " << stats.misses << ", evictions " << stats.evictions << ", thrashes " << stats.thrashes << ", decodes " << stats.decodes << std::endl;
+}
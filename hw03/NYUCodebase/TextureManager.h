@@ -0,0 +1,79 @@
+#pragma once
+
+#ifdef _WINDOWS
+	#include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL_opengl.h>
+#include <string>
+#include <vector>
+
+#define DEFAULT_TEXTURE_BUDGET (64 * 1024 * 1024)
+#define DEFAULT_PIXEL_CACHE_BUDGET (32 * 1024 * 1024)
+#define TEXTURE_THRASH_FRAMES 60
+
+struct TextureStats {
+	unsigned int hits;
+	unsigned int misses;
+	unsigned int evictions;
+	unsigned int thrashes;
+	unsigned int decodes;
+	size_t residentBytes;
+	size_t peakBytes;
+	size_t cachedBytes;
+	size_t budget;
+	size_t cacheBudget;
+};
+
+// Owns every texture loaded from disk. Callers keep a handle instead of a GL name;
+// textures that have not been bound recently are deleted when the byte budget is
+// exceeded and uploaded again the next time they are bound. Decoded pixels are
+// kept in system memory under a separate budget so most reloads skip the disk;
+// the least recently bound ones are dropped first and decoded again when needed.
+class TextureManager {
+public:
+	int Load(const char *filePath);
+	void Bind(int texture);
+	GLuint GetTextureID(int texture);
+
+	void BeginFrame();
+	void SetBudget(size_t bytes);
+	void SetCacheBudget(size_t bytes);
+	void Cleanup();
+
+	TextureStats GetStats() const;
+	void PrintStats() const;
+
+private:
+	struct Texture {
+		std::string filePath;
+		std::vector<unsigned char> pixels;
+		int width;
+		int height;
+		GLuint textureID;
+		bool resident;
+		size_t bytes;
+		unsigned int lastUsedFrame;
+		unsigned int evictedFrame;
+	};
+
+	void MakeResident(Texture &texture);
+	void MakeRoom(size_t bytes);
+	void TrimCache();
+	void Decode(Texture &texture);
+	void Upload(Texture &texture);
+
+	std::vector<Texture> textures;
+	size_t budget = DEFAULT_TEXTURE_BUDGET;
+	size_t residentBytes = 0;
+	size_t peakBytes = 0;
+	size_t cachedBytes = 0;
+	size_t cacheBudget = DEFAULT_PIXEL_CACHE_BUDGET;
+	unsigned int frame = 1;
+
+	unsigned int hits = 0;
+	unsigned int misses = 0;
+	unsigned int evictions = 0;
+	unsigned int thrashes = 0;
+	unsigned int decodes = 0;
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <atomic>
+
+#define TRIPLE_BUFFER_FRESH 4
+
+// Hands the newest value from one writer thread to one reader thread without locks.
+// The writer fills Back() and calls Publish(); the reader calls Read() and keeps
+// the returned value until its next Read(). Neither side ever waits: the writer
+// always has a free slot and the reader always gets the latest complete value,
+// skipping any the writer published in between.
+template <typename T>
+class TripleBuffer {
+public:
+	T &Back() { return slots[back]; }
+
+	void Publish() {
+		int previous = middle.exchange(back | TRIPLE_BUFFER_FRESH, std::memory_order_acq_rel);
+		back = previous & ~TRIPLE_BUFFER_FRESH;
+	}
+
+	const T &Read() {
+		if (middle.load(std::memory_order_relaxed) & TRIPLE_BUFFER_FRESH) {
+			front = middle.exchange(front, std::memory_order_acq_rel) & ~TRIPLE_BUFFER_FRESH;
+		}
+		return slots[front];
+	}
+
+private:
+	T slots[3];
+	int back = 0;
+	std::atomic<int> middle{ 1 };
+	int front = 2;
+};
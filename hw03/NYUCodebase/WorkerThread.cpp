@@ -0,0 +1,52 @@
+
+#include "WorkerThread.h"
+
+WorkerThread::~WorkerThread() {
+	Stop();
+}
+
+void WorkerThread::Run(const std::function<void()> &work) {
+	if (!thread.joinable()) {
+		stopping = false;
+		thread = std::thread(&WorkerThread::Loop, this);
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		job = work;
+		busy = true;
+	}
+	ready.notify_one();
+}
+
+void WorkerThread::Wait() {
+	std::unique_lock<std::mutex> lock(mutex);
+	finished.wait(lock, [this] { return !busy; });
+}
+
+void WorkerThread::Stop() {
+	if (!thread.joinable()) {
+		return;
+	}
+	Wait();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	ready.notify_one();
+	thread.join();
+}
+
+void WorkerThread::Loop() {
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		ready.wait(lock, [this] { return stopping || busy; });
+		if (stopping) {
+			return;
+		}
+		lock.unlock();
+		job();
+		lock.lock();
+		busy = false;
+		finished.notify_all();
+	}
+}
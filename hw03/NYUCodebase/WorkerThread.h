@@ -0,0 +1,29 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Runs one job at a time on a thread that stays alive between jobs, so handing a
+// small piece of work to another core every tick does not create a thread each
+// time. Run() hands the job over and returns at once; Wait() blocks until it is done.
+class WorkerThread {
+public:
+	~WorkerThread();
+
+	void Run(const std::function<void()> &work);
+	void Wait();
+	void Stop();
+
+private:
+	void Loop();
+
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable ready;
+	std::condition_variable finished;
+	std::function<void()> job;
+	bool busy = false;
+	bool stopping = false;
+};
@@ -0,0 +1,9 @@
+uniform sampler2D texture0;
+
+varying vec2 texCoordVar;
+varying float alphaVar;
+
+// The sheet is premultiplied, so fading scales every channel
+void main() {
+	gl_FragColor = texture2D(texture0, texCoordVar) * alphaVar;
+}
\ No newline at end of file
@@ -0,0 +1,20 @@
+attribute vec4 position;
+attribute vec2 texCoord;
+attribute vec3 affineX;
+attribute vec3 affineY;
+attribute vec4 uvRect;
+
+uniform mat4 viewMatrix;
+uniform mat4 projectionMatrix;
+
+varying vec2 texCoordVar;
+
+// position is a corner of the unit quad and texCoord picks the matching corner of
+// uvRect; affineX and affineY are the two rows of the instance's 2x3 transform.
+void main()
+{
+	vec3 corner = vec3(position.xy, 1.0);
+	vec4 p = viewMatrix * vec4(dot(affineX, corner), dot(affineY, corner), 0.0, 1.0);
+	texCoordVar = uvRect.xy + texCoord * uvRect.zw;
+	gl_Position = projectionMatrix * p;
+}
\ No newline at end of file
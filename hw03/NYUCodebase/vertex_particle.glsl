@@ -0,0 +1,18 @@
+attribute vec4 position;
+attribute vec2 texCoord;
+attribute float alpha;
+
+uniform mat4 modelMatrix;
+uniform mat4 viewMatrix;
+uniform mat4 projectionMatrix;
+
+varying vec2 texCoordVar;
+varying float alphaVar;
+
+void main()
+{
+	vec4 p = viewMatrix * modelMatrix  * position;
+	texCoordVar = texCoord;
+	alphaVar = alpha;
+	gl_Position = projectionMatrix * p;
+}
\ No newline at end of file